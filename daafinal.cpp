@@ -6,314 +6,7615 @@
 #include <string>
 #include <queue>
 #include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <tuple>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <cctype>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <string_view>
+#include <charconv>
+#include <sstream>
+#include <cerrno>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#endif
 
 using namespace std;
 
+// Queue policy: binary heap, works for any weight type
+struct BinaryHeapQueue {
+    template <typename Weight, typename Node>
+    class Queue {
+    public:
+        Queue(Weight) {}
+        void push(Weight w, const Node& n) {
+            pq.push(make_pair(w, n));
+        }
+        bool empty() const {
+            return pq.empty();
+        }
+        pair<Weight, Node> pop() {
+            pair<Weight, Node> top = pq.top();
+            pq.pop();
+            return top;
+        }
+
+    private:
+        priority_queue<pair<Weight, Node>, vector<pair<Weight, Node>>, greater<pair<Weight, Node>>> pq;
+    };
+};
+
+// Queue policy: Dial's circular bucket queue, one bucket per distance value.
+// Only for integral weights; fastest when edge weights are small (meters between junctions).
+struct BucketQueue {
+    template <typename Weight, typename Node>
+    class Queue {
+        static_assert(is_integral<Weight>::value, "BucketQueue needs integral weights");
+
+    public:
+        Queue(Weight maxEdgeWeight) : buckets((size_t)maxEdgeWeight + 1), count(0), cursor(0) {}
+        void push(Weight w, const Node& n) {
+            buckets[(size_t)w % buckets.size()].push_back(n);
+            ++count;
+        }
+        bool empty() const {
+            return count == 0;
+        }
+        pair<Weight, Node> pop() {
+            while (buckets[(size_t)cursor % buckets.size()].empty())
+                ++cursor;
+            vector<Node>& bucket = buckets[(size_t)cursor % buckets.size()];
+            Node n = bucket.back();
+            bucket.pop_back();
+            --count;
+            return make_pair(cursor, n);
+        }
+
+    private:
+        vector<vector<Node>> buckets;
+        size_t count;
+        Weight cursor;
+    };
+};
+
+// Adjacency storage chosen at compile time from the node ID type:
+// names (string) go through a map, integral IDs index a vector directly.
+template <typename NodeId, typename Weight, bool Dense = is_integral<NodeId>::value>
+struct GraphStorage {
+    typedef map<NodeId, vector<pair<NodeId, Weight>>> Adjacency;
+    typedef map<NodeId, Weight> Distances;
+
+    static vector<pair<NodeId, Weight>>& list(Adjacency& adj, const NodeId& u) {
+        return adj[u];
+    }
+    static const vector<pair<NodeId, Weight>>* find(const Adjacency& adj, const NodeId& u) {
+        auto it = adj.find(u);
+        return it == adj.end() ? NULL : &it->second;
+    }
+    static Distances distances(const Adjacency& adj, Weight infinity) {
+        Distances dist;
+        for (const auto& node : adj)
+            dist[node.first] = infinity;
+        return dist;
+    }
+    static Weight& at(Distances& dist, const NodeId& u) {
+        return dist[u];
+    }
+};
+
+template <typename NodeId, typename Weight>
+struct GraphStorage<NodeId, Weight, true> {
+    typedef vector<vector<pair<NodeId, Weight>>> Adjacency;
+    typedef vector<Weight> Distances;
+
+    static vector<pair<NodeId, Weight>>& list(Adjacency& adj, const NodeId& u) {
+        if ((size_t)u >= adj.size())
+            adj.resize((size_t)u + 1);
+        return adj[u];
+    }
+    static const vector<pair<NodeId, Weight>>* find(const Adjacency& adj, const NodeId& u) {
+        return (size_t)u < adj.size() ? &adj[u] : NULL;
+    }
+    static Distances distances(const Adjacency& adj, Weight infinity) {
+        return Distances(adj.size(), infinity);
+    }
+    static Weight& at(Distances& dist, const NodeId& u) {
+        if ((size_t)u >= dist.size())
+            dist.resize((size_t)u + 1, numeric_limits<Weight>::max());
+        return dist[u];
+    }
+};
+
+// Graph to store a utility network (pump stations, substations and areas).
+// Weight: distance / cost / time type; NodeId: area name or compact integer ID; QueuePolicy: Dijkstra queue.
+template <typename Weight, typename NodeId, typename QueuePolicy = BinaryHeapQueue>
+class BasicGraph {
+public:
+    typedef GraphStorage<NodeId, Weight> Storage;
+    typedef typename Storage::Distances Distances;
+
+    typename Storage::Adjacency adj;
+    Weight maxEdgeWeight = Weight();
+    uint64_t revision = 0;    // bumped by every edit, so cached routes can tell they are stale
+
+    void addEdge(const NodeId& u, const NodeId& v, Weight distance) {
+        Storage::list(adj, u).push_back(make_pair(v, distance));
+        Storage::list(adj, v).push_back(make_pair(u, distance));
+        if (distance > maxEdgeWeight)
+            maxEdgeWeight = distance;
+        revision++;
+    }
+
+    Distances dijkstra(const NodeId& source) const {
+        const Weight infinity = numeric_limits<Weight>::max();
+        Distances dist = Storage::distances(adj, infinity);
+        Storage::at(dist, source) = Weight();
+
+        typename QueuePolicy::template Queue<Weight, NodeId> pq(maxEdgeWeight);
+        pq.push(Weight(), source);
+        while (!pq.empty()) {
+            pair<Weight, NodeId> top = pq.pop();
+            if (top.first > Storage::at(dist, top.second))
+                continue;
+            const vector<pair<NodeId, Weight>>* edges = Storage::find(adj, top.second);
+            if (!edges)
+                continue;
+            for (const auto& neighbor : *edges) {
+                Weight through = top.first + neighbor.second;
+                Weight& current = Storage::at(dist, neighbor.first);
+                if (through < current) {
+                    current = through;
+                    pq.push(through, neighbor.first);
+                }
+            }
+        }
+        return dist;
+    }
+
+    // Distance to the closest other node, or -1 if nothing is reachable
+    Weight nearestOtherNodeDistance(const NodeId& source) const {
+        const Weight infinity = numeric_limits<Weight>::max();
+        Distances distances = dijkstra(source);
+        Weight minDistance = infinity;
+        forEachDistance(distances, [&](const NodeId& node, Weight d) {
+            if (!(node == source) && d < minDistance)
+                minDistance = d;
+        });
+        return (minDistance == infinity) ? Weight(-1) : minDistance;
+    }
+
+private:
+    template <typename Visit>
+    static void forEachDistance(const map<NodeId, Weight>& dist, Visit visit) {
+        for (const auto& d : dist)
+            visit(d.first, d.second);
+    }
+    template <typename Visit>
+    static void forEachDistance(const vector<Weight>& dist, Visit visit) {
+        for (size_t u = 0; u < dist.size(); ++u)
+            visit((NodeId)u, dist[u]);
+    }
+};
+
+// Class to map each distinct value of a categorical field to a small integer code and back
+class StringDictionary {
+public:
+    // Code of the value, adding it if it has not been seen before
+    uint32_t encode(const string& value) {
+        auto it = codes.find(value);
+        if (it != codes.end())
+            return it->second;
+        uint32_t code = (uint32_t)values.size();
+        codes[value] = code;
+        values.push_back(value);
+        return code;
+    }
+
+    // Code of the value, or -1 if it has never been encoded
+    int64_t find(const string& value) const {
+        auto it = codes.find(value);
+        return it == codes.end() ? -1 : (int64_t)it->second;
+    }
+
+    const string& decode(uint32_t code) const {
+        return values[code];
+    }
+
+    size_t size() const {
+        return values.size();
+    }
+
+private:
+    unordered_map<string, uint32_t> codes;
+    vector<string> values;
+};
+
+// Class to hold a categorical field (material, status, billing cycle, ...) in one byte.
+// Values lists the values known up front, which get fixed codes starting at 1 (0 is the empty
+// value); anything else is appended to a dictionary shared by every field of the same kind.
+template <typename Values>
+class Categorical {
+public:
+    Categorical() : value(0) {}
+    Categorical(typename Values::Code code) : value((uint8_t)code) {}
+    Categorical(const string& name) : value(encode(name)) {}
+    Categorical(const char* name) : value(encode(name)) {}
+
+    uint8_t code() const {
+        return value;
+    }
+
+    const string& name() const {
+        return dictionary().decode(value);
+    }
+
+    // Code of the value, or -1 if no field of this kind has ever held it
+    static int find(const string& name) {
+        return (int)dictionary().find(name);
+    }
+
+    static StringDictionary& dictionary() {
+        static StringDictionary values = seeded();
+        return values;
+    }
+
+    friend bool operator==(Categorical a, Categorical b) {
+        return a.value == b.value;
+    }
+    friend bool operator!=(Categorical a, Categorical b) {
+        return a.value != b.value;
+    }
+    friend bool operator==(Categorical a, const char* name) {
+        return a.value == find(name);
+    }
+    friend bool operator!=(Categorical a, const char* name) {
+        return a.value != find(name);
+    }
+    friend bool operator==(Categorical a, const string& name) {
+        return a.value == find(name);
+    }
+    friend bool operator!=(Categorical a, const string& name) {
+        return a.value != find(name);
+    }
+
+    friend ostream& operator<<(ostream& out, Categorical c) {
+        return out << c.name();
+    }
+
+    // Reads one word that must be one of Values::names; anything else sets failbit (so promptFor asks
+    // again) rather than taking one of the shared dictionary's 256 codes
+    friend istream& operator>>(istream& in, Categorical& c) {
+        string text;
+        if (!(in >> text))
+            return in;
+        for (const char* name : Values::names)
+            if (text == name) {
+                c = Categorical(name);
+                return in;
+            }
+        in.setstate(ios::failbit);
+        return in;
+    }
+
+private:
+    uint8_t value;
+
+    static uint8_t encode(const string& name) {
+        StringDictionary& values = dictionary();
+        int64_t known = values.find(name);
+        if (known >= 0)
+            return (uint8_t)known;
+        if (values.size() > UINT8_MAX) {
+            cout << "Too many distinct values, \"" << name << "\" is stored as empty." << endl;
+            return 0;
+        }
+        return (uint8_t)values.encode(name);
+    }
+
+    static StringDictionary seeded() {
+        StringDictionary values;
+        values.encode("");
+        for (const char* name : Values::names)
+            values.encode(name);
+        return values;
+    }
+};
+
+// Class to hold an amount of money as a whole number of paise (1 rupee = 100 paise), so sums are exact
+// and come out the same whatever order (or thread) they are added in. Whenever a result falls between
+// two paise (rupee input, rate x quantity, tax) it is rounded to the nearest paisa, halves away from zero.
+class Money {
+public:
+    constexpr Money() : amount(0) {}
+
+    // e.g. Money(2500.5) is 250050 paise
+    explicit Money(double rupees) : amount(roundHalfAway(rupees * 100.0)) {}
+
+    static constexpr Money fromPaise(int64_t paise) {
+        Money m;
+        m.amount = paise;
+        return m;
+    }
+
+    static constexpr Money fromRupees(int64_t rupees, int64_t paise = 0) {
+        return fromPaise(rupees * 100 + paise);
+    }
+
+    // Parses "2500", "-12.5" or "99.999" exactly (digits past the paise are rounded); false if malformed
+    static bool parse(string_view text, Money& result) {
+        size_t i = 0;
+        bool negative = false;
+        if (i < text.size() && (text[i] == '-' || text[i] == '+'))
+            negative = text[i++] == '-';
+        int64_t paise = 0;
+        size_t digits = 0;
+        for (; i < text.size() && isdigit((unsigned char)text[i]); ++i, ++digits) {
+            if (paise > (INT64_MAX - 9) / 1000)
+                return false;
+            paise = paise * 10 + (text[i] - '0');
+        }
+        paise *= 100;
+        if (i < text.size() && text[i] == '.') {
+            ++i;
+            int64_t scale = 10;
+            for (size_t decimals = 0; i < text.size() && isdigit((unsigned char)text[i]); ++i, ++decimals, ++digits) {
+                if (decimals < 2) {
+                    paise += (text[i] - '0') * scale;
+                    scale /= 10;
+                } else if (decimals == 2 && text[i] >= '5') {
+                    paise += 1;
+                }
+            }
+        }
+        if (digits == 0 || i != text.size())
+            return false;
+        result.amount = negative ? -paise : paise;
+        return true;
+    }
+
+    int64_t paise() const {
+        return amount;
+    }
+
+    double rupees() const {
+        return amount / 100.0;
+    }
+
+    // Rate x quantity, e.g. a rate per meter times a length
+    Money times(double quantity) const {
+        return fromPaise(roundHalfAway(amount * quantity));
+    }
+
+    Money operator*(int64_t count) const {
+        return fromPaise(amount * count);
+    }
+
+    Money operator+(Money other) const {
+        return fromPaise(amount + other.amount);
+    }
+    Money operator-(Money other) const {
+        return fromPaise(amount - other.amount);
+    }
+    Money operator-() const {
+        return fromPaise(-amount);
+    }
+    Money& operator+=(Money other) {
+        amount += other.amount;
+        return *this;
+    }
+    Money& operator-=(Money other) {
+        amount -= other.amount;
+        return *this;
+    }
+
+    bool operator==(Money other) const { return amount == other.amount; }
+    bool operator!=(Money other) const { return amount != other.amount; }
+    bool operator<(Money other) const { return amount < other.amount; }
+    bool operator<=(Money other) const { return amount <= other.amount; }
+    bool operator>(Money other) const { return amount > other.amount; }
+    bool operator>=(Money other) const { return amount >= other.amount; }
+
+    // Writes e.g. "2500.50" without a terminating zero and returns the end; out needs 24 chars
+    char* format(char* out) const {
+        uint64_t magnitude = amount < 0 ? 0 - (uint64_t)amount : (uint64_t)amount;
+        if (amount < 0)
+            *out++ = '-';
+        out = to_chars(out, out + 20, magnitude / 100).ptr;
+        *out++ = '.';
+        *out++ = (char)('0' + magnitude % 100 / 10);
+        *out++ = (char)('0' + magnitude % 10);
+        return out;
+    }
+
+    string str() const {
+        char text[24];
+        return string(text, format(text));
+    }
+
+    // Rounds a number of paise (or hundredths of paise, see Percentage) half away from zero
+    static int64_t roundHalfAway(double paise) {
+        // The nudge reads e.g. 0.285 rupees (stored as 28.4999... paise) as the 28.5 it was written as
+        return llround(paise + copysign(1e-6, paise));
+    }
+
+private:
+    int64_t amount;   // paise
+};
+
+ostream& operator<<(ostream& out, Money money)
+{
+    return out << money.str();
+}
+
+// Reads one token such as "2500.50"; sets failbit if it is not an amount
+istream& operator>>(istream& in, Money& money)
+{
+    string text;
+    if (in >> text && !Money::parse(text, money))
+        in.setstate(ios::failbit);
+    return in;
+}
+
+// Class to hold a tax or penalty rate exactly, in hundredths of a percent (basis points): 18.5% is 1850
+class Percentage {
+public:
+    constexpr Percentage() : points(0) {}
+
+    static constexpr Percentage basisPoints(int64_t points) {
+        Percentage p;
+        p.points = points;
+        return p;
+    }
+
+    // Parses "18", "12.25" or "18.125" (percent), rounded to the basis point as Money::parse rounds
+    // to the paisa; false if malformed or negative
+    static bool parse(string_view text, Percentage& result) {
+        Money asMoney;   // the same digits: two decimals
+        if (!Money::parse(text, asMoney) || asMoney.paise() < 0)
+            return false;
+        result.points = asMoney.paise();
+        return true;
+    }
+
+    int64_t basisPoints() const {
+        return points;
+    }
+
+    // The rate applied to an amount, rounded to the paisa half away from zero
+    Money of(Money amount) const {
+        return Money::fromPaise(applyBasisPoints(amount.paise(), points));
+    }
+
+    // Exact integer rounding shared by of() and the batch kernels, so both always agree
+    static int64_t applyBasisPoints(int64_t paise, int64_t points) {
+        int64_t scaled = paise * points;
+        int64_t half = 5000 - ((scaled >> 63) & 10000);   // +5000, or -5000 for a negative amount
+        return (scaled + half) / 10000;
+    }
+
+private:
+    int64_t points;
+};
+
+ostream& operator<<(ostream& out, Percentage rate)
+{
+    out << rate.basisPoints() / 100;
+    if (rate.basisPoints() % 100 != 0) {
+        char decimals[4] = {'.', (char)('0' + rate.basisPoints() % 100 / 10), (char)('0' + rate.basisPoints() % 10), 0};
+        if (decimals[2] == '0')
+            decimals[2] = 0;
+        out << decimals;
+    }
+    return out;
+}
+
+istream& operator>>(istream& in, Percentage& rate)
+{
+    string text;
+    if (in >> text && !Percentage::parse(text, rate))
+        in.setstate(ios::failbit);
+    return in;
+}
+
+// Function to print prompt and read value from cin, asking again while the input is not valid.
+// Returns false only if the input ends; a rejected line is skipped so later reads are not affected.
+template <typename T>
+bool promptFor(const char* prompt, T& value)
+{
+    cout << prompt;
+    while (!(cin >> value)) {
+        if (cin.eof())
+            return false;
+        cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cout << "Invalid value. " << prompt;
+    }
+    return true;
+}
+
+static_assert(sizeof(Money) == sizeof(int64_t), "Money arrays are read as int64_t arrays by the batch kernels");
+
+// Function to add up an array of amounts
+Money sumMoney(const Money* values, size_t n)
+{
+    const int64_t* paise = (const int64_t*)values;
+    size_t i = 0;
+    int64_t total = 0;
+#ifdef __AVX2__
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_epi64(acc0, _mm256_loadu_si256((const __m256i*)(paise + i)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_loadu_si256((const __m256i*)(paise + i + 4)));
+    }
+    alignas(32) int64_t lanes[4];
+    _mm256_store_si256((__m256i*)lanes, _mm256_add_epi64(acc0, acc1));
+    total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+    for (; i < n; ++i)
+        total += paise[i];
+    return Money::fromPaise(total);
+}
+
+// Function to work out the tax on each of n amounts and the taxed totals, with the same rounding as
+// Percentage::of; the loop is branch-free so the compiler can vectorize it
+void applyTax(const Money* amounts, size_t n, Percentage rate, Money* taxes, Money* totals)
+{
+    const int64_t* paise = (const int64_t*)amounts;
+    int64_t* tax = (int64_t*)taxes;
+    int64_t* total = (int64_t*)totals;
+    int64_t points = rate.basisPoints();
+    for (size_t i = 0; i < n; ++i) {
+        int64_t t = Percentage::applyBasisPoints(paise[i], points);
+        tax[i] = t;
+        total[i] = paise[i] + t;
+    }
+}
+
+// Structure to hold the bill of materials of a run of pipe segments. Weights and coating follow from the
+// totals for any material (volume x density) and coating (surface x coating thickness), so one pass over
+// the segments prices steel and polythene pipe and every coating.
+struct PipeBillOfMaterials {
+    size_t segments = 0;
+    double length = 0;         // meters
+    double pipeVolume = 0;     // cubic meters of pipe wall
+    double surfaceArea = 0;    // square meters of outer surface
+
+    double pipeWeight(double density) const {
+        return pipeVolume * density;
+    }
+
+    double coatingVolume(double coatingThickness) const {
+        return surfaceArea * coatingThickness;
+    }
+
+    double coatingWeight(double coatingThickness, double density) const {
+        return coatingVolume(coatingThickness) * density;
+    }
+};
+
+// Function to work out the pipe wall volume and outer surface of n segments (meters) in one pass.
+// Wall volume = PI * thickness * (outer diameter - thickness) * length, the difference of the outer and
+// inner cylinders without squaring either radius; surface = PI * outer diameter * length. thicknesses may
+// be NULL for the surface only; per-segment results go to pipeVolumes / surfaceAreas unless NULL.
+PipeBillOfMaterials pipeBillOfMaterials(const double* lengths, const double* outerDiameters, const double* thicknesses,
+                                        size_t n, double* pipeVolumes = NULL, double* surfaceAreas = NULL)
+{
+    const double PI = 3.14159265359;
+    PipeBillOfMaterials bill;
+    bill.segments = n;
+    size_t i = 0;
+#ifdef __AVX2__
+    const __m256d pi = _mm256_set1_pd(PI);
+    __m256d length = _mm256_setzero_pd(), volume = _mm256_setzero_pd(), surface = _mm256_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        __m256d l = _mm256_loadu_pd(lengths + i);
+        __m256d circumference = _mm256_mul_pd(pi, _mm256_loadu_pd(outerDiameters + i));
+        __m256d s = _mm256_mul_pd(circumference, l);
+        length = _mm256_add_pd(length, l);
+        surface = _mm256_add_pd(surface, s);
+        if (surfaceAreas)
+            _mm256_storeu_pd(surfaceAreas + i, s);
+        if (thicknesses) {
+            __m256d t = _mm256_loadu_pd(thicknesses + i);
+            __m256d wall = _mm256_mul_pd(_mm256_mul_pd(pi, t), _mm256_sub_pd(_mm256_loadu_pd(outerDiameters + i), t));
+            __m256d v = _mm256_mul_pd(wall, l);
+            volume = _mm256_add_pd(volume, v);
+            if (pipeVolumes)
+                _mm256_storeu_pd(pipeVolumes + i, v);
+        }
+    }
+    double lanes[3][4];
+    _mm256_storeu_pd(lanes[0], length);
+    _mm256_storeu_pd(lanes[1], volume);
+    _mm256_storeu_pd(lanes[2], surface);
+    bill.length = lanes[0][0] + lanes[0][1] + lanes[0][2] + lanes[0][3];
+    bill.pipeVolume = lanes[1][0] + lanes[1][1] + lanes[1][2] + lanes[1][3];
+    bill.surfaceArea = lanes[2][0] + lanes[2][1] + lanes[2][2] + lanes[2][3];
+#endif
+    for (; i < n; ++i) {
+        double s = PI * outerDiameters[i] * lengths[i];
+        bill.length += lengths[i];
+        bill.surfaceArea += s;
+        if (surfaceAreas)
+            surfaceAreas[i] = s;
+        if (thicknesses) {
+            double v = PI * thicknesses[i] * (outerDiameters[i] - thicknesses[i]) * lengths[i];
+            bill.pipeVolume += v;
+            if (pipeVolumes)
+                pipeVolumes[i] = v;
+        }
+    }
+    return bill;
+}
+
+// Class to format text into a reusable buffer: numbers go through to_chars and nothing is allocated
+// once the buffer has grown to the size of the largest record. Doubles print like cout's default
+// (6 significant digits), so a display() can switch from cout chains without changing its output.
+class TextBuffer {
+public:
+    explicit TextBuffer(size_t capacity = 4096) : bytes(capacity) {}
+
+    const char* data() const {
+        return bytes.data();
+    }
+
+    size_t size() const {
+        return used;
+    }
+
+    void clear() {
+        used = 0;
+    }
+
+    void reserve(size_t capacity) {
+        if (capacity > bytes.size())
+            bytes.resize(capacity);
+    }
+
+    TextBuffer& operator<<(string_view text) {
+        memcpy(room(text.size()), text.data(), text.size());
+        used += text.size();
+        return *this;
+    }
+    TextBuffer& operator<<(const char* text) {
+        return *this << string_view(text);
+    }
+    TextBuffer& operator<<(const string& text) {
+        return *this << string_view(text);
+    }
+    TextBuffer& operator<<(char c) {
+        *room(1) = c;
+        used++;
+        return *this;
+    }
+
+    template <typename Integer, typename enable_if<is_integral<Integer>::value && !is_same<Integer, char>::value && !is_same<Integer, bool>::value, int>::type = 0>
+    TextBuffer& operator<<(Integer value) {
+        char* out = room(24);
+        used = to_chars(out, out + 24, value).ptr - bytes.data();
+        return *this;
+    }
+
+    TextBuffer& operator<<(double value) {
+        char* out = room(32);
+        used = to_chars(out, out + 32, value, chars_format::general, 6).ptr - bytes.data();
+        return *this;
+    }
+
+    TextBuffer& operator<<(Money value) {
+        used = value.format(room(24)) - bytes.data();
+        return *this;
+    }
+
+    template <typename Values>
+    TextBuffer& operator<<(const Categorical<Values>& value) {
+        return *this << string_view(value.name());
+    }
+
+    // e.g. fixed(12.5, 2) is "12.50"
+    TextBuffer& fixed(double value, int decimals) {
+        char* out = room(352);
+        used = to_chars(out, out + 352, value, chars_format::fixed, decimals).ptr - bytes.data();
+        return *this;
+    }
+
+    // Like formatTimestamp, "10-Jan-2025 06:00" (UTC)
+    TextBuffer& timestamp(int64_t seconds) {
+        time_t t = (time_t)seconds;
+        struct tm parts;
+#ifdef _WIN32
+        gmtime_s(&parts, &t);
+#else
+        gmtime_r(&t, &parts);
+#endif
+        used += strftime(room(32), 32, "%d-%b-%Y %H:%M", &parts);
+        return *this;
+    }
+
+private:
+    vector<char> bytes;
+    size_t used = 0;
+
+    // Pointer to at least n free bytes at the end of the text
+    char* room(size_t n) {
+        if (used + n > bytes.size())
+            bytes.resize(max(bytes.size() * 2, used + n));
+        return bytes.data() + used;
+    }
+};
+
+// Class to write rendered text to a file or pipe in large blocks. Records are formatted into a ring of
+// reusable TextBuffers; when the ring is full all of it goes out in one writev call, so millions of
+// records take a few hundred system calls. The FILE's own buffer is flushed first, so output already
+// written through it (or through cout) stays in order.
+class BlockWriter {
+public:
+    static const size_t BLOCK_SIZE = 1 << 16;
+    static const int BLOCKS = 16;
+
+    // Blocks start small and grow to BLOCK_SIZE (plus one record) as they are used
+    explicit BlockWriter(FILE* file) : out(file), blocks(BLOCKS) {
+        fflush(out);
+    }
+
+    ~BlockWriter() {
+        flush();
+    }
+
+    // Buffer to format the next record into
+    TextBuffer& text() {
+        if (blocks[current].size() >= BLOCK_SIZE && ++current == BLOCKS)
+            flush();
+        return blocks[current];
+    }
+
+    // Writes text formatted elsewhere (e.g. by a worker thread) after everything buffered, in the same call
+    bool write(const char* data, size_t length) {
+        return writeBlocks(data, length);
+    }
+
+    bool flush() {
+        return writeBlocks(NULL, 0);
+    }
+
+    bool failed() const {
+        return writeFailed;
+    }
+
+    uint64_t bytesWritten() const {
+        return written;
+    }
+
+    uint64_t systemCalls() const {
+        return calls;
+    }
+
+private:
+    FILE* out;
+    vector<TextBuffer> blocks;
+    int current = 0;
+    bool writeFailed = false;
+    uint64_t written = 0;
+    uint64_t calls = 0;
+
+    bool writeBlocks(const char* extra, size_t extraLength) {
+#ifndef _WIN32
+        iovec parts[BLOCKS + 1];
+        int count = 0;
+        for (int b = 0; b <= current && b < BLOCKS; ++b)
+            if (blocks[b].size() > 0)
+                parts[count++] = iovec{(void*)blocks[b].data(), blocks[b].size()};
+        if (extraLength > 0)
+            parts[count++] = iovec{(void*)extra, extraLength};
+
+        // writev may write only part of the blocks (pipes, signals): carry on from where it stopped
+        int fd = fileno(out);
+        iovec* next = parts;
+        while (count > 0 && !writeFailed) {
+            ssize_t n = writev(fd, next, count);
+            calls++;
+            if (n < 0) {
+                writeFailed = errno != EINTR;
+                continue;
+            }
+            written += n;
+            while (count > 0 && (size_t)n >= next->iov_len) {
+                n -= next->iov_len;
+                next++;
+                count--;
+            }
+            if (count > 0) {
+                next->iov_base = (char*)next->iov_base + n;
+                next->iov_len -= n;
+            }
+        }
+#else
+        for (int b = 0; b <= current && b < BLOCKS; ++b) {
+            writeFailed |= fwrite(blocks[b].data(), 1, blocks[b].size(), out) != blocks[b].size();
+            written += blocks[b].size();
+            calls++;
+        }
+        if (extraLength > 0) {
+            writeFailed |= fwrite(extra, 1, extraLength, out) != extraLength;
+            written += extraLength;
+            calls++;
+        }
+        writeFailed |= fflush(out) != 0;
+#endif
+        for (TextBuffer& block : blocks)
+            block.clear();
+        current = 0;
+        return !writeFailed;
+    }
+};
+
+// Class to price each value of a categorical field; a lookup is one array index by code
+template <typename Values>
+class RateTable {
+public:
+    typedef Categorical<Values> Key;
+
+    // Rates in rupees, e.g. {{"Steel", 900.0}, {"PVC", 400.0}}
+    RateTable(initializer_list<pair<const char*, double>> entries) {
+        for (const auto& entry : entries)
+            set(entry.first, Money(entry.second));
+    }
+
+    void set(Key key, Money rate) {
+        if (key.code() >= rates.size()) {
+            rates.resize(key.code() + 1);
+            priced.resize(key.code() + 1, 0);
+        }
+        rates[key.code()] = rate;
+        priced[key.code()] = 1;
+        changes++;
+    }
+
+    bool has(Key key) const {
+        return key.code() < rates.size() && priced[key.code()];
+    }
+
+    // 0 if the value has no rate
+    Money at(Key key) const {
+        return key.code() < rates.size() ? rates[key.code()] : Money();
+    }
+
+    // Number of rates set so far; changes whenever a rate does
+    uint64_t revision() const {
+        return changes;
+    }
+
+private:
+    vector<Money> rates;      // 0 where there is no rate
+    vector<uint8_t> priced;   // 1 where a rate was set
+    uint64_t changes = 0;
+};
+
+// Function giving the number of codes of a categorical field known up front, counting 0 (the empty value)
+template <typename Values>
+constexpr size_t knownCodes()
+{
+    return sizeof(Values::names) / sizeof(Values::names[0]) + 1;
+}
+
+// Class to price each pair of values of two categorical fields (e.g. supply type x billing cycle) from one
+// flat row-major array sized at compile time. A table can be written as a list of entries and built by the
+// compiler (constexpr), and a lookup is one indexed load. Values added at run time have codes past the
+// known ones and all share one extra row / column that is never priced.
+template <typename RowValues, typename ColumnValues>
+class TariffGrid {
+public:
+    typedef Categorical<RowValues> Row;
+    typedef Categorical<ColumnValues> Column;
+    static constexpr size_t ROWS = knownCodes<RowValues>() + 1;
+    static constexpr size_t COLUMNS = knownCodes<ColumnValues>() + 1;
+
+    struct Entry {
+        typename RowValues::Code row;
+        typename ColumnValues::Code column;
+        Money rate;
+    };
+
+    constexpr TariffGrid() : rates(), priced(), changes(0) {}
+
+    // e.g. {{SupplyTypeValues::Regular, BillingCycleValues::Monthly, Money::fromRupees(100)}, ...}
+    constexpr TariffGrid(initializer_list<Entry> entries) : rates(), priced(), changes(0) {
+        for (const Entry& entry : entries) {
+            rates[slot(entry.row, entry.column)] = entry.rate;
+            priced[slot(entry.row, entry.column)] = true;
+        }
+    }
+
+    // False (and nothing set) for a value that is not known up front
+    bool set(Row row, Column column, Money rate) {
+        if (row.code() >= ROWS - 1 || column.code() >= COLUMNS - 1)
+            return false;
+        rates[slot(row.code(), column.code())] = rate;
+        priced[slot(row.code(), column.code())] = true;
+        changes++;
+        return true;
+    }
+
+    bool has(Row row, Column column) const {
+        return priced[slot(row.code(), column.code())];
+    }
+
+    // 0 if the pair has no rate
+    Money at(Row row, Column column) const {
+        return rates[slot(row.code(), column.code())];
+    }
+
+    // Number of rates set after construction
+    uint64_t revision() const {
+        return changes;
+    }
+
+private:
+    Money rates[ROWS * COLUMNS];     // 0 where there is no rate
+    bool priced[ROWS * COLUMNS];
+    uint64_t changes;
+
+    static constexpr size_t slot(size_t row, size_t column) {
+        return min(row, ROWS - 1) * COLUMNS + min(column, COLUMNS - 1);
+    }
+};
+
+// Class to hold a tariff grid that can be replaced from a file while it is being read: a reader takes the
+// current table with one atomic load and keeps using it for as long as it likes, since replaced tables
+// are only freed with the holder (reloads are rare and a table is a few hundred bytes).
+template <typename RowValues, typename ColumnValues>
+class ReloadableTariff {
+public:
+    typedef TariffGrid<RowValues, ColumnValues> Grid;
+
+    explicit ReloadableTariff(const Grid& initial) {
+        versions.push_back(unique_ptr<Grid>(new Grid(initial)));
+        current.store(versions.back().get());
+    }
+
+    const Grid& table() const {
+        return *current.load(memory_order_acquire);
+    }
+
+    bool has(typename Grid::Row row, typename Grid::Column column) const {
+        return table().has(row, column);
+    }
+
+    Money at(typename Grid::Row row, typename Grid::Column column) const {
+        return table().at(row, column);
+    }
+
+    // Number of successful reloads
+    uint64_t revision() const {
+        return reloads.load(memory_order_acquire);
+    }
+
+    // Replaces the whole table with the lines of a file such as
+    //   # supply type, billing cycle, rate in rupees
+    //   Regular,Monthly,100.00
+    // If any line is bad the current table stays in place.
+    bool reload(const string& path) {
+        FILE* in = fopen(path.c_str(), "rb");
+        if (!in) {
+            cout << "Error: could not open " << path << endl;
+            return false;
+        }
+        unique_ptr<Grid> next(new Grid());
+        string line;
+        size_t lineNumber = 0, rates = 0;
+        bool ok = true;
+        for (int ch = 0; ok && ch != EOF;) {
+            line.clear();
+            while ((ch = fgetc(in)) != EOF && ch != '\n')
+                line += (char)ch;
+            lineNumber++;
+            ok = parseLine(line, *next, rates);
+            if (!ok)
+                cout << "Error: " << path << " line " << lineNumber << ": expected <known value>,<known value>,<rate>" << endl;
+        }
+        fclose(in);
+        if (!ok)
+            return false;
+
+        lock_guard<mutex> lock(reloadMutex);
+        versions.push_back(move(next));
+        current.store(versions.back().get(), memory_order_release);
+        reloads.fetch_add(1, memory_order_release);
+        cout << "Tariff reloaded from " << path << " (" << rates << " rates)." << endl;
+        return true;
+    }
+
+private:
+    atomic<const Grid*> current;
+    atomic<uint64_t> reloads{0};
+    mutex reloadMutex;
+    vector<unique_ptr<Grid>> versions;   // every table handed out so far
+
+    static string_view trim(string_view text) {
+        while (!text.empty() && isspace((unsigned char)text.front()))
+            text.remove_prefix(1);
+        while (!text.empty() && isspace((unsigned char)text.back()))
+            text.remove_suffix(1);
+        return text;
+    }
+
+    static bool parseLine(string_view line, Grid& grid, size_t& rates) {
+        size_t hash = line.find('#');
+        if (hash != string_view::npos)
+            line = line.substr(0, hash);
+        line = trim(line);
+        if (line.empty())
+            return true;
+        size_t first = line.find(','), second = line.find(',', first == string_view::npos ? first : first + 1);
+        if (second == string_view::npos)
+            return false;
+        int row = Categorical<RowValues>::find(string(trim(line.substr(0, first))));
+        int column = Categorical<ColumnValues>::find(string(trim(line.substr(first + 1, second - first - 1))));
+        Money rate;
+        if (row <= 0 || column <= 0 || !Money::parse(trim(line.substr(second + 1)), rate))
+            return false;
+        if (!grid.set(typename Grid::Row((typename RowValues::Code)row), typename Grid::Column((typename ColumnValues::Code)column), rate))
+            return false;
+        rates++;
+        return true;
+    }
+};
+
+// Functions to look up a rate in either the string-keyed maps or the code-indexed tables (0 if missing)
+Money rateOf(const map<string, Money>& rates, const string& key)
+{
+    auto it = rates.find(key);
+    return it == rates.end() ? Money() : it->second;
+}
+
+Money rateOf(const map<string, map<string, Money>>& rates, const string& row, const string& column)
+{
+    auto it = rates.find(row);
+    if (it == rates.end() || !it->second.count(column))
+        return Money();
+    return it->second.at(column);
+}
+
+template <typename Values>
+Money rateOf(const RateTable<Values>& rates, const Categorical<Values>& key)
+{
+    return rates.at(key);
+}
+
+template <typename Values>
+Money rateOf(const RateTable<Values>& rates, const string& key)
+{
+    int code = Categorical<Values>::find(key);
+    return code < 0 ? Money() : rates.at(Categorical<Values>((typename Values::Code)code));
+}
+
+template <typename RowValues, typename ColumnValues>
+Money rateOf(const TariffGrid<RowValues, ColumnValues>& rates, const Categorical<RowValues>& row, const Categorical<ColumnValues>& column)
+{
+    return rates.at(row, column);
+}
+
+template <typename RowValues, typename ColumnValues>
+Money rateOf(const TariffGrid<RowValues, ColumnValues>& rates, const string& row, const string& column)
+{
+    int r = Categorical<RowValues>::find(row), c = Categorical<ColumnValues>::find(column);
+    if (r < 0 || c < 0)
+        return Money();
+    return rates.at(Categorical<RowValues>((typename RowValues::Code)r), Categorical<ColumnValues>((typename ColumnValues::Code)c));
+}
+
+template <typename RowValues, typename ColumnValues, typename RowKey, typename ColumnKey>
+Money rateOf(const ReloadableTariff<RowValues, ColumnValues>& rates, const RowKey& row, const ColumnKey& column)
+{
+    return rateOf(rates.table(), row, column);
+}
+
+// Functions to tell whether a rate source has changed: the revision moves on with every change. The
+// string-keyed maps have no revision and are taken to be fixed once set up.
+template <typename Rates>
+uint64_t tariffRevision(const Rates&)
+{
+    return 0;
+}
+
+template <typename Values>
+uint64_t tariffRevision(const RateTable<Values>& rates)
+{
+    return rates.revision();
+}
+
+template <typename RowValues, typename ColumnValues>
+uint64_t tariffRevision(const TariffGrid<RowValues, ColumnValues>& rates)
+{
+    return rates.revision();
+}
+
+template <typename RowValues, typename ColumnValues>
+uint64_t tariffRevision(const ReloadableTariff<RowValues, ColumnValues>& rates)
+{
+    return rates.revision();
+}
+
+// Name of the config file with the slab tariffs, read from the working directory at start-up
+// (tariffs.cfg.example shows the format)
+const char* const SLAB_TARIFF_CONFIG = "tariffs.cfg";
+
+// Class to charge metered usage by slab: each band of units has its own rate per unit (e.g. 0-10, 10-25
+// and 25+), usage in peak or off-peak hours is charged at a percentage of that, and no bill falls below
+// the minimum charge. A batch of usage values is charged four at a time with branch-free AVX2 code;
+// a single value goes through the same code, so single and batch charges always agree.
+class SlabTariff {
+public:
+    static const int MAX_SLABS = 8;
+    enum Period : uint8_t { Standard, Peak, OffPeak };
+
+    SlabTariff() {
+        for (int i = 0; i < MAX_SLABS; ++i)
+            bandStart[i] = bandWidth[i] = ratePaise[i] = 0;
+        factors[Standard] = factors[Peak] = factors[OffPeak] = 1.0;
+    }
+
+    // Reads the [section] of a config file such as
+    //   [water]
+    //   slab 10 5.00        # the first 10 units at 5.00 per unit
+    //   slab 25 7.50        # units above 10 and up to 25
+    //   slab * 10.00        # everything above 25
+    //   minimum 50.00
+    //   peak 18 22 120      # 18:00-22:00 (UTC, like formatTimestamp) at 120%
+    //   offpeak 22 6 80
+    // Returns false without a message if the file or the section does not exist, so flat rates apply.
+    static bool load(const string& path, const string& section, SlabTariff& tariff) {
+        FILE* in = fopen(path.c_str(), "rb");
+        if (!in)
+            return false;
+        SlabTariff next;
+        bool inSection = false, found = false, ok = true, open = true;
+        string line;
+        size_t lineNumber = 0;
+        for (int ch = 0; ok && ch != EOF;) {
+            line.clear();
+            while ((ch = fgetc(in)) != EOF && ch != '\n')
+                line += (char)ch;
+            lineNumber++;
+            size_t hash = line.find('#');
+            if (hash != string::npos)
+                line.erase(hash);
+            istringstream words(line);
+            string keyword;
+            if (!(words >> keyword))
+                continue;
+            if (keyword[0] == '[') {
+                inSection = keyword == "[" + section + "]";
+                found = found || inSection;
+                continue;
+            }
+            if (!inSection)
+                continue;
+
+            string bound, extra;
+            Money money;
+            Percentage rate;
+            int from = -1, to = -1;
+            if (keyword == "slab" && words >> bound >> money && !(words >> extra)) {
+                char* end = NULL;
+                double upTo = bound == "*" ? INFINITY : strtod(bound.c_str(), &end);
+                ok = open && money >= Money() && (end == NULL || *end == 0) && next.addSlab(upTo, money);
+                open = bound != "*";
+            } else if (keyword == "minimum" && words >> money && !(words >> extra)) {
+                ok = money >= Money();
+                next.setMinimumCharge(money);
+            } else if ((keyword == "peak" || keyword == "offpeak") && words >> from >> to >> rate && !(words >> extra)) {
+                ok = from >= 0 && from < 24 && to >= 0 && to < 24;
+                next.setTimeOfDay(keyword == "peak" ? Peak : OffPeak, from, to, rate);
+            } else {
+                ok = false;
+            }
+            if (!ok)
+                cout << "Error: " << path << " line " << lineNumber << ": bad " << keyword << " rule in [" << section << "]" << endl;
+        }
+        fclose(in);
+        if (ok && found && (next.slabs == 0 || open)) {
+            cout << "Error: " << path << " [" << section << "] must end with a \"slab * <rate>\" band" << endl;
+            ok = false;
+        }
+        if (!ok || !found)
+            return false;
+        tariff = next;
+        return true;
+    }
+
+    // Bands are added in order of their upper bound; INFINITY closes the schedule
+    bool addSlab(double upTo, Money rate) {
+        double start = slabs == 0 ? 0.0 : bandStart[slabs - 1] + bandWidth[slabs - 1];
+        if (slabs == MAX_SLABS || !(upTo > start))
+            return false;
+        bandStart[slabs] = start;
+        bandWidth[slabs] = upTo - start;
+        ratePaise[slabs] = (double)rate.paise();
+        slabs++;
+        return true;
+    }
+
+    void setMinimumCharge(Money charge) {
+        minimumCharge = charge;
+    }
+
+    // Hours [from, to) may wrap midnight; from == to turns the period off
+    void setTimeOfDay(Period period, int from, int to, Percentage rate) {
+        windows[period] = make_pair(from, to);
+        factors[period] = rate.basisPoints() / 10000.0;
+    }
+
+    // Period of a reading time
+    Period periodAt(int64_t timestamp) const {
+        time_t t = (time_t)timestamp;
+        int hour = gmtime(&t)->tm_hour;
+        for (Period period : {Peak, OffPeak}) {
+            int from = windows[period].first, to = windows[period].second;
+            if (from < to ? hour >= from && hour < to : from > to && (hour >= from || hour < to))
+                return period;
+        }
+        return Standard;
+    }
+
+    Money charge(double units, Period period = Standard) const {
+        uint8_t p = period;
+        Money result;
+        chargeBatch(&units, &p, 1, &result);
+        return result;
+    }
+
+    // periods may be NULL (all Standard)
+    void chargeBatch(const double* units, const uint8_t* periods, size_t n, Money* charges) const {
+        double paise[4];
+        for (size_t i = 0; i < n; i += 4) {
+            size_t lanes = min<size_t>(4, n - i);
+            double in[4] = {0, 0, 0, 0};
+            int32_t period[4] = {0, 0, 0, 0};
+            for (size_t k = 0; k < lanes; ++k) {
+                in[k] = units[i + k];
+                period[k] = periods ? min<int32_t>(periods[i + k], OffPeak) : Standard;
+            }
+            chargeFour(in, period, paise);
+            for (size_t k = 0; k < lanes; ++k)
+                charges[i + k] = Money::fromPaise(Money::roundHalfAway(paise[k]));
+        }
+    }
+
+    int slabCount() const {
+        return slabs;
+    }
+
+    Money minimum() const {
+        return minimumCharge;
+    }
+
+private:
+    int slabs = 0;
+    double bandStart[MAX_SLABS];
+    double bandWidth[MAX_SLABS];     // INFINITY for the last band
+    double ratePaise[MAX_SLABS];     // per unit
+    double factors[3];               // by Period
+    pair<int, int> windows[3] = {{0, 0}, {0, 0}, {0, 0}};
+    Money minimumCharge;
+
+    // Charge of four usage values in paise, before rounding: every band is applied to every lane
+    // (units past the band start, capped at the band width), so there is no branch on the usage
+    void chargeFour(const double* units, const int32_t* period, double* paise) const {
+#ifdef __AVX2__
+        __m256d u = _mm256_loadu_pd(units), zero = _mm256_setzero_pd(), total = zero;
+        for (int b = 0; b < slabs; ++b) {
+            __m256d inBand = _mm256_min_pd(_mm256_max_pd(_mm256_sub_pd(u, _mm256_set1_pd(bandStart[b])), zero),
+                                           _mm256_set1_pd(bandWidth[b]));
+            total = _mm256_add_pd(total, _mm256_mul_pd(inBand, _mm256_set1_pd(ratePaise[b])));
+        }
+        __m256d p = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)period));
+        __m256d factor = _mm256_blendv_pd(_mm256_set1_pd(factors[Standard]), _mm256_set1_pd(factors[Peak]),
+                                          _mm256_cmp_pd(p, _mm256_set1_pd(Peak), _CMP_EQ_OQ));
+        factor = _mm256_blendv_pd(factor, _mm256_set1_pd(factors[OffPeak]), _mm256_cmp_pd(p, _mm256_set1_pd(OffPeak), _CMP_EQ_OQ));
+        total = _mm256_max_pd(_mm256_mul_pd(total, factor), _mm256_set1_pd((double)minimumCharge.paise()));
+        _mm256_storeu_pd(paise, total);
+#else
+        for (int k = 0; k < 4; ++k) {
+            double total = 0;
+            for (int b = 0; b < slabs; ++b)
+                total += min(max(units[k] - bandStart[b], 0.0), bandWidth[b]) * ratePaise[b];
+            paise[k] = max(total * factors[period[k]], (double)minimumCharge.paise());
+        }
+#endif
+    }
+};
+
+// Structure to represent the ground conditions along one pipe / line segment of the network
+struct SegmentConditions {
+    string terrain = "Flat";     // Flat, Hilly, Mountainous
+    string soil = "Sandy";       // Sandy, Clay, Rocky
+    string surface = "Unpaved";  // Unpaved, Paved, Highway
+};
+
+// Name of the config file with the stations and ground conditions of the networks, read from the working
+// directory at start-up (network.cfg.example shows the format)
+const char* const NETWORK_CONFIG = "network.cfg";
+
+// Structure to hold the installation data of a network: the stations routes end at, the ground conditions
+// of its segments and the cost multiplier of each condition
+struct NetworkConditions {
+    vector<string> stations;
+    vector<tuple<string, string, SegmentConditions>> segments;
+    map<string, double> terrain, soil, surface;
+
+    // Reads the [conditions] and [section] parts of a config file such as
+    //   [conditions]
+    //   terrain Hilly 1.25         # cost multiplier of each condition; one not listed costs 1.0
+    //   soil Rocky 1.45
+    //   surface Paved 1.2
+    //   [water]
+    //   station Tilakwadi
+    //   segment Shaniwar Khoot | Khanjar Galli | Hilly Clay Paved
+    // Returns false without a message if the file or the section does not exist.
+    static bool load(const string& path, const string& section, NetworkConditions& network) {
+        FILE* in = fopen(path.c_str(), "rb");
+        if (!in)
+            return false;
+        NetworkConditions next;
+        string current, line;
+        bool found = false, ok = true;
+        size_t lineNumber = 0;
+        for (int ch = 0; ok && ch != EOF;) {
+            line.clear();
+            while ((ch = fgetc(in)) != EOF && ch != '\n')
+                line += (char)ch;
+            lineNumber++;
+            size_t hash = line.find('#');
+            if (hash != string::npos)
+                line.erase(hash);
+            istringstream words(line);
+            string keyword, name, extra;
+            if (!(words >> keyword))
+                continue;
+            if (keyword[0] == '[') {
+                current = keyword;
+                found = found || current == "[" + section + "]";
+                continue;
+            }
+
+            double factor = 0;
+            if (current == "[conditions]") {
+                map<string, double>* table = keyword == "terrain" ? &next.terrain : keyword == "soil" ? &next.soil
+                                             : keyword == "surface" ? &next.surface : NULL;
+                ok = table && words >> name >> factor && !(words >> extra) && factor > 0;
+                if (ok)
+                    (*table)[name] = factor;
+            } else if (current == "[" + section + "]") {
+                string rest;
+                getline(words, rest);
+                vector<string> fields = split(rest);
+                if (keyword == "station" && fields.size() == 1 && !fields[0].empty()) {
+                    next.stations.push_back(fields[0]);
+                } else if (keyword == "segment" && fields.size() == 3 && !fields[0].empty() && !fields[1].empty()) {
+                    SegmentConditions conditions;
+                    istringstream ground(fields[2]);
+                    ok = ground >> conditions.terrain >> conditions.soil >> conditions.surface && !(ground >> extra);
+                    next.segments.push_back(make_tuple(fields[0], fields[1], conditions));
+                } else {
+                    ok = false;
+                }
+            }
+            if (!ok)
+                cout << "Error: " << path << " line " << lineNumber << ": bad " << keyword << " line" << endl;
+        }
+        fclose(in);
+        if (!ok || !found)
+            return false;
+        network = next;
+        return true;
+    }
+
+    double multiplierOf(const SegmentConditions& c) const {
+        return factorOf(terrain, c.terrain) * factorOf(soil, c.soil) * factorOf(surface, c.surface);
+    }
+
+private:
+    static double factorOf(const map<string, double>& factors, const string& condition) {
+        auto it = factors.find(condition);
+        return it == factors.end() ? 1.0 : it->second;
+    }
+
+    // Fields separated by '|', trimmed
+    static vector<string> split(const string& text) {
+        vector<string> fields;
+        size_t start = 0;
+        for (;;) {
+            size_t bar = text.find('|', start);
+            string field = text.substr(start, bar == string::npos ? string::npos : bar - start);
+            size_t first = field.find_first_not_of(" \t\r"), last = field.find_last_not_of(" \t\r");
+            fields.push_back(first == string::npos ? string() : field.substr(first, last - first + 1));
+            if (bar == string::npos)
+                return fields;
+            start = bar + 1;
+        }
+    }
+};
+
+// Structure to represent one itemized line of an installation quote
+struct QuoteLine {
+    string from;
+    string to;
+    int meters;
+    SegmentConditions conditions;
+    double multiplier;  // terrain x soil x surface
+    Money cost;         // meters x material rate x multiplier
+};
+
+// Structure to represent an itemized installation quote along the actual route
+struct InstallationQuote {
+    bool routeFound = false;
+    string destination;         // nearest pump station / substation
+    int totalMeters = 0;
+    Money materialRate;         // per meter
+    vector<QuoteLine> lines;
+    Money routeCost;
+    Money supplyCost;
+    Money total;
+
+    void display() const {
+        cout << "\nInstallation Quote (route to " << destination << ", " << totalMeters << " meters):\n";
+        for (size_t i = 0; i < lines.size(); ++i) {
+            const QuoteLine& line = lines[i];
+            cout << i + 1 << ". " << line.from << " -> " << line.to << ": " << line.meters << " m x "
+                 << materialRate << " x " << line.multiplier << " (" << line.conditions.terrain << ", "
+                 << line.conditions.soil << ", " << line.conditions.surface << ") = " << line.cost << "\n";
+        }
+        cout << "Route cost: " << routeCost << "\nSupply / connection cost: " << supplyCost
+             << "\nTotal installation cost: " << total << endl;
+    }
+};
+
+// Class to price an installation along the shortest route to the nearest station instead of at one flat
+// rate per meter; the stations, segment conditions and multipliers come from a NetworkConditions
+// (without stations, the closest other node is taken as the station). Shortest-path trees are cached
+// per customer location, and whole quotes per location and selections, so asking again for a quote
+// (e.g. finalizing after changing a selection back) is one hash lookup. Both caches are dropped when
+// the graph's revision or a tariff's revision moves on.
+// Works with any graph exposing adj as map<string, vector<pair<string, int>>> and a revision counter
+// (water and electricity), and with rates kept either in string-keyed maps or in code-indexed RateTable /
+// TariffGrid / ReloadableTariff.
+template <typename GraphType, typename MaterialRates = map<string, Money>, typename SupplyPricing = map<string, map<string, Money>>>
+class RouteCostEngine {
+public:
+    RouteCostEngine(const GraphType& graph, const MaterialRates& rates, const SupplyPricing& pricing)
+        : g(graph), materialRates(rates), supplyPricing(pricing) {}
+
+    void setSegmentConditions(const string& u, const string& v, const SegmentConditions& conditions) {
+        segmentConditions[make_pair(u, v)] = conditions;
+        segmentConditions[make_pair(v, u)] = conditions;
+        invalidate();
+    }
+
+    // Takes the stations, segment conditions and multipliers of a network; returns how many of its
+    // stations and segments are not in the graph (they are skipped)
+    size_t configure(const NetworkConditions& conditions) {
+        network = conditions;
+        segmentConditions.clear();
+        size_t unknown = 0;
+        for (const string& station : network.stations)
+            unknown += g.adj.count(station) == 0;
+        for (const auto& segment : network.segments) {
+            auto from = g.adj.find(get<0>(segment));
+            bool isEdge = from != g.adj.end() && any_of(from->second.begin(), from->second.end(),
+                                                         [&](const pair<string, int>& e) { return e.first == get<1>(segment); });
+            if (isEdge)
+                setSegmentConditions(get<0>(segment), get<1>(segment), get<2>(segment));
+            unknown += !isEdge;
+        }
+        invalidate();
+        return unknown;
+    }
+
+    // Drops every cached route and quote; changes to the graph and to the tariffs are noticed without it,
+    // except changes to string-keyed rate maps
+    void invalidate() {
+        built = false;
+        trees.clear();
+        quotes.clear();
+    }
+
+    // The quote stays valid until the next quote after a graph or tariff change
+    template <typename Material, typename Supply, typename Cycle>
+    const InstallationQuote& quote(const string& location, const Material& material, const Supply& supplyType, const Cycle& billingCycle) {
+        refresh();
+        string key = location;
+        appendKey(key, material);
+        appendKey(key, supplyType);
+        appendKey(key, billingCycle);
+        auto cached = quotes.find(key);
+        if (cached != quotes.end()) {
+            hits++;
+            return cached->second;
+        }
+        misses++;
+        return quotes.emplace(move(key), price(location, material, supplyType, billingCycle)).first->second;
+    }
+
+    // Meters along the shortest route from a location to the nearest station (the route quote prices), or
+    // -1 if there is none
+    int nearestStationMeters(const string& location) {
+        refresh();
+        if (!built)
+            build();
+        auto id = ids.find(location);
+        if (id == ids.end())
+            return -1;
+        const Tree& tree = treeFor(id->second);
+        return tree.nearest < 0 ? -1 : tree.dist[tree.nearest];
+    }
+
+    uint64_t cacheHits() const {
+        return hits;
+    }
+
+    uint64_t cacheMisses() const {
+        return misses;
+    }
+
+private:
+    template <typename Material, typename Supply, typename Cycle>
+    InstallationQuote price(const string& location, const Material& material, const Supply& supplyType, const Cycle& billingCycle) {
+        InstallationQuote q;
+        q.materialRate = rateOf(materialRates, material);
+        q.supplyCost = rateOf(supplyPricing, supplyType, billingCycle);
+
+        if (!built)
+            build();
+        auto id = ids.find(location);
+        if (id == ids.end()) {
+            q.total = q.supplyCost;
+            return q;
+        }
+        const Tree& tree = treeFor(id->second);
+        if (tree.nearest < 0) {
+            q.total = q.supplyCost;
+            return q;
+        }
+
+        q.routeFound = true;
+        q.destination = names[tree.nearest];
+        q.totalMeters = tree.dist[tree.nearest];
+        for (int v = tree.nearest; v != id->second;) {
+            int e = tree.parentEdge[v];
+            int u = edgeFrom[e];
+            QuoteLine line;
+            line.from = names[u];
+            line.to = names[v];
+            line.meters = edgeMeters[e];
+            line.conditions = conditionsOf(line.from, line.to);
+            line.multiplier = edgeMultiplier[e];
+            line.cost = q.materialRate.times(line.meters * line.multiplier);
+            q.routeCost += line.cost;
+            q.lines.push_back(line);
+            v = u;
+        }
+        reverse(q.lines.begin(), q.lines.end());
+        q.total = q.routeCost + q.supplyCost;
+        return q;
+    }
+
+    struct Tree {
+        vector<int> dist;
+        vector<int> parentEdge;
+        int nearest = -1;
+    };
+
+    const GraphType& g;
+    const MaterialRates& materialRates;
+    const SupplyPricing& supplyPricing;
+    NetworkConditions network;
+    map<pair<string, string>, SegmentConditions> segmentConditions;
+
+    bool built = false;
+    vector<string> names;
+    map<string, int> ids;
+    vector<int> offsets, edgeTo, edgeFrom, edgeMeters;
+    vector<double> edgeMultiplier;
+    vector<uint8_t> isStation;       // by node
+    bool hasStations = false;
+    unordered_map<int, Tree> trees;
+
+    unordered_map<string, InstallationQuote> quotes;   // by location + selections
+    uint64_t graphRevision = 0, materialRevision = 0, supplyRevision = 0;
+    uint64_t hits = 0, misses = 0;
+
+    void refresh() {
+        if (g.revision != graphRevision || tariffRevision(materialRates) != materialRevision
+            || tariffRevision(supplyPricing) != supplyRevision) {
+            invalidate();
+            graphRevision = g.revision;
+            materialRevision = tariffRevision(materialRates);
+            supplyRevision = tariffRevision(supplyPricing);
+        }
+    }
+
+    // Selections are appended to the key by name, each after a separator no name contains
+    static void appendKey(string& key, const string& value) {
+        key += '\x1f';
+        key += value;
+    }
+
+    template <typename Values>
+    static void appendKey(string& key, Categorical<Values> value) {
+        appendKey(key, value.name());
+    }
+
+    SegmentConditions conditionsOf(const string& u, const string& v) const {
+        auto it = segmentConditions.find(make_pair(u, v));
+        return it == segmentConditions.end() ? SegmentConditions() : it->second;
+    }
+
+    // Flatten the network into arrays with the multiplier of every edge precomputed
+    void build() {
+        names.clear();
+        ids.clear();
+        offsets.assign(1, 0);
+        edgeTo.clear();
+        edgeFrom.clear();
+        edgeMeters.clear();
+        edgeMultiplier.clear();
+        for (const auto& node : g.adj) {
+            ids[node.first] = (int)names.size();
+            names.push_back(node.first);
+        }
+        for (const auto& node : g.adj) {
+            for (const auto& neighbor : node.second) {
+                edgeFrom.push_back(ids[node.first]);
+                edgeTo.push_back(ids[neighbor.first]);
+                edgeMeters.push_back(neighbor.second);
+                edgeMultiplier.push_back(network.multiplierOf(conditionsOf(node.first, neighbor.first)));
+            }
+            offsets.push_back((int)edgeTo.size());
+        }
+        isStation.assign(names.size(), 0);
+        hasStations = false;
+        for (const string& station : network.stations) {
+            auto id = ids.find(station);
+            if (id != ids.end()) {
+                isStation[id->second] = 1;
+                hasStations = true;
+            }
+        }
+        built = true;
+    }
+
+    const Tree& treeFor(int source) {
+        auto cached = trees.find(source);
+        if (cached != trees.end())
+            return cached->second;
+
+        Tree& tree = trees[source];
+        tree.dist.assign(names.size(), INT_MAX);
+        tree.parentEdge.assign(names.size(), -1);
+        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+        tree.dist[source] = 0;
+        pq.push(make_pair(0, source));
+        while (!pq.empty()) {
+            int du = pq.top().first;
+            int u = pq.top().second;
+            pq.pop();
+            if (du > tree.dist[u])
+                continue;
+            // Nodes come off the queue nearest first, so the first station is the nearest one and the
+            // path to it is final. Without stations, the closest other node is taken as the station, as
+            // getShortestDistanceToPumpStation does.
+            if (hasStations ? isStation[u] : u != source) {
+                tree.nearest = u;
+                break;
+            }
+            for (int e = offsets[u]; e < offsets[u + 1]; ++e) {
+                int v = edgeTo[e];
+                if (du + edgeMeters[e] < tree.dist[v]) {
+                    tree.dist[v] = du + edgeMeters[e];
+                    tree.parentEdge[v] = e;
+                    pq.push(make_pair(tree.dist[v], v));
+                }
+            }
+        }
+        return tree;
+    }
+};
+
+
+// Structure to represent one meter reading
+struct UsageReading {
+    int64_t timestamp;  // seconds since the epoch
+    double volume;      // usage during the reading period
+    double amount;      // amount billed for it
+};
+
+// Structure to hold the totals of a range or window of readings
+struct UsageTotals {
+    int64_t from = 0;
+    uint64_t readings = 0;
+    double volume = 0;
+    double amount = 0;
+};
+
+// Structure to represent one fixed-size block of compressed readings in a UsageArena.
+// The first reading is kept in the header; every later one is stored as zigzag varint deltas
+// (time, volume, amount) from the one before. Blocks link back to the previous block of the series.
+struct UsageBlock {
+    static const size_t BYTES = 512;
+    static const uint32_t NONE = UINT32_MAX;
+
+    int64_t firstTime, lastTime;
+    int64_t firstVolume, firstAmount;    // volume in thousandths, amount in hundredths
+    int64_t lastVolume, lastAmount;
+    int64_t sumVolume, sumAmount;
+    uint32_t prev;
+    uint16_t count;
+    uint16_t used;                       // payload bytes
+    uint8_t sealed;                      // full: nothing may be appended any more
+    uint8_t payload[BYTES - 8 * 8 - 9];
+};
+static_assert(sizeof(UsageBlock) == UsageBlock::BYTES, "UsageBlock must be exactly one block");
+
+// Class to store the usage blocks of many customers together; blocks are never moved.
+// Each block counts the series tails and later blocks that point at it, and goes on a free list
+// for reuse once nothing does any more.
+// Blocks live in fixed chunks whose table is reserved up front, so operator[] reads a block without the
+// lock while another thread allocates: neither the table nor a chunk is ever reallocated.
+class UsageArena {
+public:
+    static const int CHUNK_BITS = 12;     // 4096 blocks (2 MB) per chunk
+
+    UsageArena() {
+        chunks.reserve(((size_t)UINT32_MAX >> CHUNK_BITS) + 1);
+    }
+
+    // New block with one reference, held by the caller
+    uint32_t allocate() {
+        lock_guard<mutex> lock(guard);
+        if (!freeBlocks.empty()) {
+            uint32_t index = freeBlocks.back();
+            freeBlocks.pop_back();
+            refs[index] = 1;
+            return index;
+        }
+        if ((count >> CHUNK_BITS) == chunks.size())
+            chunks.push_back(unique_ptr<UsageBlock[]>(new UsageBlock[(size_t)1 << CHUNK_BITS]));
+        refs.push_back(1);
+        return (uint32_t)count++;
+    }
+
+    void retain(uint32_t index) {
+        if (index == UsageBlock::NONE)
+            return;
+        lock_guard<mutex> lock(guard);
+        refs[index]++;
+    }
+
+    // Drop one reference; a block nothing points at any more is freed, along with its own hold on prev
+    void release(uint32_t index) {
+        lock_guard<mutex> lock(guard);
+        while (index != UsageBlock::NONE && --refs[index] == 0) {
+            freeBlocks.push_back(index);
+            index = (*this)[index].prev;
+        }
+    }
+
+    UsageBlock& operator[](uint32_t index) {
+        return chunks[index >> CHUNK_BITS][index & ((1u << CHUNK_BITS) - 1)];
+    }
+    const UsageBlock& operator[](uint32_t index) const {
+        return chunks[index >> CHUNK_BITS][index & ((1u << CHUNK_BITS) - 1)];
+    }
+
+    // Bytes held by blocks still in use
+    size_t bytes() const {
+        lock_guard<mutex> lock(guard);
+        return (count - freeBlocks.size()) * sizeof(UsageBlock);
+    }
+
+    size_t freeCount() const {
+        lock_guard<mutex> lock(guard);
+        return freeBlocks.size();
+    }
+
+private:
+    mutable mutex guard;
+    vector<unique_ptr<UsageBlock[]>> chunks;    // capacity never grows past the reserve
+    size_t count = 0;                           // blocks handed out so far
+    deque<uint32_t> refs;
+    vector<uint32_t> freeBlocks;
+};
+
+// Function to get the arena shared by every customer's usage history
+UsageArena& sharedUsageArena()
+{
+    static UsageArena arena;
+    return arena;
+}
+
+// Class to represent the append-only usage history of one customer inside a UsageArena.
+// Copies share the blocks written so far; when a copy appends after another copy already has,
+// it clones its tail block first, so every copy keeps seeing exactly its own readings.
+// The blocks go back to the arena when the last series holding them is destroyed.
+class UsageSeries {
+public:
+    UsageSeries() {}
+
+    UsageSeries(const UsageSeries& other)
+        : home(other.home), tail(other.tail), tailUsed(other.tailUsed), tailCount(other.tailCount), total(other.total) {
+        if (home)
+            home->retain(tail);
+    }
+
+    UsageSeries(UsageSeries&& other) noexcept
+        : home(other.home), tail(other.tail), tailUsed(other.tailUsed), tailCount(other.tailCount), total(other.total) {
+        other.home = NULL;
+        other.tail = UsageBlock::NONE;
+        other.tailUsed = other.tailCount = 0;
+        other.total = 0;
+    }
+
+    UsageSeries& operator=(UsageSeries other) {
+        swap(home, other.home);
+        swap(tail, other.tail);
+        swap(tailUsed, other.tailUsed);
+        swap(tailCount, other.tailCount);
+        swap(total, other.total);
+        return *this;
+    }
+
+    ~UsageSeries() {
+        clear();
+    }
+
+    // Drop every reading, returning blocks no other copy shares to the arena
+    void clear() {
+        if (home && tail != UsageBlock::NONE)
+            home->release(tail);
+        home = NULL;
+        tail = UsageBlock::NONE;
+        tailUsed = tailCount = 0;
+        total = 0;
+    }
+
+    uint64_t size() const {
+        return total;
+    }
+
+    // Readings must arrive in time order; false (and nothing recorded) for one older than the last
+    bool append(UsageArena& arena, const UsageReading& reading) {
+        int64_t volume = llround(reading.volume * 1000.0);
+        int64_t amount = llround(reading.amount * 100.0);
+        if (tail == UsageBlock::NONE) {
+            home = &arena;
+            startBlock(arena, UsageBlock::NONE, reading.timestamp, volume, amount);
+            return true;
+        }
+        if (reading.timestamp < lastTime(arena))
+            return false;
+        if (!ownsTail(arena))
+            cloneTail(arena);
+
+        UsageBlock& block = arena[tail];
+        uint8_t encoded[30];
+        size_t length = 0;
+        length += putVarint(encoded + length, zigzag(reading.timestamp - block.lastTime));
+        length += putVarint(encoded + length, zigzag(volume - block.lastVolume));
+        length += putVarint(encoded + length, zigzag(amount - block.lastAmount));
+        if (block.used + length > sizeof(block.payload)) {
+            block.sealed = 1;
+            startBlock(arena, tail, reading.timestamp, volume, amount);
+            return true;
+        }
+        memcpy(block.payload + block.used, encoded, length);
+        block.used += (uint16_t)length;
+        block.count++;
+        block.lastTime = reading.timestamp;
+        block.lastVolume = volume;
+        block.lastAmount = amount;
+        block.sumVolume += volume;
+        block.sumAmount += amount;
+        tailUsed = block.used;
+        tailCount = block.count;
+        total++;
+        return true;
+    }
+
+    // Visit the readings with from <= timestamp <= to, oldest first
+    template <typename Visit>
+    void forEach(const UsageArena& arena, int64_t from, int64_t to, Visit visit) const {
+        for (uint32_t b : blocksOverlapping(arena, from, to)) {
+            decode(arena[b], countIn(arena, b), [&](int64_t time, int64_t volume, int64_t amount) {
+                if (time >= from && time <= to)
+                    visit(UsageReading{time, volume / 1000.0, amount / 100.0});
+            });
+        }
+    }
+
+    vector<UsageReading> range(const UsageArena& arena, int64_t from, int64_t to) const {
+        vector<UsageReading> readings;
+        forEach(arena, from, to, [&](const UsageReading& r) { readings.push_back(r); });
+        return readings;
+    }
+
+    // Totals of [from, to]; blocks lying wholly inside are added from their headers
+    UsageTotals sum(const UsageArena& arena, int64_t from, int64_t to) const {
+        UsageTotals totals;
+        totals.from = from;
+        int64_t volume = 0, amount = 0;
+        for (uint32_t b : blocksOverlapping(arena, from, to)) {
+            const UsageBlock& block = arena[b];
+            if (b != tail && block.firstTime >= from && block.lastTime <= to) {
+                totals.readings += block.count;
+                volume += block.sumVolume;
+                amount += block.sumAmount;
+                continue;
+            }
+            decode(block, countIn(arena, b), [&](int64_t time, int64_t v, int64_t a) {
+                if (time >= from && time <= to) {
+                    totals.readings++;
+                    volume += v;
+                    amount += a;
+                }
+            });
+        }
+        totals.volume = volume / 1000.0;
+        totals.amount = amount / 100.0;
+        return totals;
+    }
+
+    // Totals of consecutive windows of the given length (seconds) starting at from
+    vector<UsageTotals> windowedSums(const UsageArena& arena, int64_t from, int64_t to, int64_t window) const {
+        vector<UsageTotals> windows;
+        if (window <= 0 || to < from)
+            return windows;
+        windows.resize((size_t)((to - from) / window + 1));
+        vector<int64_t> volume(windows.size(), 0), amount(windows.size(), 0);
+        for (size_t w = 0; w < windows.size(); ++w)
+            windows[w].from = from + (int64_t)w * window;
+
+        for (uint32_t b : blocksOverlapping(arena, from, to)) {
+            const UsageBlock& block = arena[b];
+            size_t first = (size_t)((max(block.firstTime, from) - from) / window);
+            if (b != tail && block.firstTime >= from && block.lastTime <= to
+                && first == (size_t)((block.lastTime - from) / window)) {
+                windows[first].readings += block.count;
+                volume[first] += block.sumVolume;
+                amount[first] += block.sumAmount;
+                continue;
+            }
+            decode(block, countIn(arena, b), [&](int64_t time, int64_t v, int64_t a) {
+                if (time >= from && time <= to) {
+                    size_t w = (size_t)((time - from) / window);
+                    windows[w].readings++;
+                    volume[w] += v;
+                    amount[w] += a;
+                }
+            });
+        }
+        for (size_t w = 0; w < windows.size(); ++w) {
+            windows[w].volume = volume[w] / 1000.0;
+            windows[w].amount = amount[w] / 100.0;
+        }
+        return windows;
+    }
+
+private:
+    UsageArena* home = NULL;    // arena holding the blocks, set by the first append
+    uint32_t tail = UsageBlock::NONE;
+    uint16_t tailUsed = 0;
+    uint16_t tailCount = 0;
+    uint64_t total = 0;
+
+    static uint64_t zigzag(int64_t v) {
+        return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+    }
+    static int64_t unzigzag(uint64_t v) {
+        return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+    }
+    static size_t putVarint(uint8_t* out, uint64_t v) {
+        size_t n = 0;
+        while (v >= 0x80) {
+            out[n++] = (uint8_t)(v | 0x80);
+            v >>= 7;
+        }
+        out[n++] = (uint8_t)v;
+        return n;
+    }
+    static uint64_t getVarint(const uint8_t*& in) {
+        uint64_t v = 0;
+        for (int shift = 0;; shift += 7) {
+            uint8_t byte = *in++;
+            v |= (uint64_t)(byte & 0x7f) << shift;
+            if (byte < 0x80)
+                return v;
+        }
+    }
+
+    // Decode the first count readings of a block (quantized values)
+    template <typename Visit>
+    static void decode(const UsageBlock& block, uint16_t count, Visit visit) {
+        int64_t time = block.firstTime, volume = block.firstVolume, amount = block.firstAmount;
+        const uint8_t* in = block.payload;
+        for (uint16_t i = 0; i < count; ++i) {
+            if (i > 0) {
+                time += unzigzag(getVarint(in));
+                volume += unzigzag(getVarint(in));
+                amount += unzigzag(getVarint(in));
+            }
+            visit(time, volume, amount);
+        }
+    }
+
+    // Another copy of this series may have appended to the shared tail block
+    bool ownsTail(const UsageArena& arena) const {
+        const UsageBlock& block = arena[tail];
+        return !block.sealed && block.used == tailUsed && block.count == tailCount;
+    }
+
+    // Time of this copy's last reading, without cloning a shared tail
+    int64_t lastTime(const UsageArena& arena) const {
+        if (ownsTail(arena))
+            return arena[tail].lastTime;
+        int64_t last = 0;
+        decode(arena[tail], tailCount, [&last](int64_t time, int64_t, int64_t) { last = time; });
+        return last;
+    }
+
+    uint16_t countIn(const UsageArena& arena, uint32_t b) const {
+        return b == tail ? tailCount : arena[b].count;
+    }
+
+    // Blocks of this series that may hold readings in [from, to], oldest first
+    vector<uint32_t> blocksOverlapping(const UsageArena& arena, int64_t from, int64_t to) const {
+        vector<uint32_t> found;
+        for (uint32_t b = tail; b != UsageBlock::NONE; b = arena[b].prev) {
+            const UsageBlock& block = arena[b];
+            if (b != tail && block.lastTime < from)
+                break;
+            if (block.firstTime <= to)
+                found.push_back(b);
+        }
+        reverse(found.begin(), found.end());
+        return found;
+    }
+
+    void startBlock(UsageArena& arena, uint32_t prev, int64_t time, int64_t volume, int64_t amount) {
+        uint32_t index = arena.allocate();
+        UsageBlock& block = arena[index];
+        block.firstTime = block.lastTime = time;
+        block.firstVolume = block.lastVolume = block.sumVolume = volume;
+        block.firstAmount = block.lastAmount = block.sumAmount = amount;
+        block.prev = prev;
+        block.count = 1;
+        block.used = 0;
+        block.sealed = 0;
+        tail = index;
+        tailUsed = 0;
+        tailCount = 1;
+        total++;
+    }
+
+    // Give this copy a private tail block holding only its own readings
+    void cloneTail(UsageArena& arena) {
+        uint32_t index = arena.allocate();
+        arena.retain(arena[tail].prev);
+        const UsageBlock& shared = arena[tail];
+        UsageBlock& block = arena[index];
+        block = shared;
+        block.used = tailUsed;
+        block.count = tailCount;
+        block.sealed = 0;
+        block.sumVolume = block.sumAmount = 0;
+        decode(block, tailCount, [&](int64_t time, int64_t volume, int64_t amount) {
+            block.lastTime = time;
+            block.lastVolume = volume;
+            block.lastAmount = amount;
+            block.sumVolume += volume;
+            block.sumAmount += amount;
+        });
+        arena.release(tail);
+        tail = index;
+    }
+};
+
+// Function to format a reading timestamp as e.g. "10-Jan-2025 06:00" (UTC)
+string formatTimestamp(int64_t timestamp)
+{
+    time_t t = (time_t)timestamp;
+    char text[32];
+    strftime(text, sizeof(text), "%d-%b-%Y %H:%M", gmtime(&t));
+    return text;
+}
+
+// Structure to hold the totals of a billing cycle: the open one so far, or a closed one
+struct BillingCycleTotals {
+    int64_t from = 0;        // first reading of the cycle (0 if it has none)
+    int64_t to = 0;          // when it was closed, or the time asked about
+    uint64_t readings = 0;
+    double volume = 0;
+    Money amount;
+
+    void display() const {
+        BlockWriter out(stdout);
+        render(out.text());
+    }
+
+    void render(TextBuffer& out) const {
+        if (readings == 0) {
+            out << "no readings\n";
+            return;
+        }
+        out << readings << " reading(s) from ";
+        out.timestamp(from) << " to ";
+        out.timestamp(to) << ", usage " << volume << ", amount " << amount << '\n';
+    }
+};
+
+// Class to keep running totals of a customer's readings for the open billing cycle and for all time.
+// Each reading is added in O(1) as it is appended, so closing a cycle copies the totals instead of
+// scanning the usage history. Volume is kept in thousandths and amount in paise, rounded the way
+// UsageSeries stores them, so the totals equal a sum over the series exactly.
+class BillingAccumulator {
+public:
+    void add(const UsageReading& reading) {
+        int64_t volume = llround(reading.volume * 1000.0);
+        Money amount = Money::fromPaise(llround(reading.amount * 100.0));
+        if (cycleReadings == 0)
+            cycleFrom = reading.timestamp;
+        if (allReadings == 0)
+            allFrom = reading.timestamp;
+        cycleReadings++;
+        cycleVolume += volume;
+        cycleAmount += amount;
+        allReadings++;
+        allVolume += volume;
+        allAmount += amount;
+    }
+
+    // The open cycle as of a time
+    BillingCycleTotals current(int64_t asOf) const {
+        return totals(cycleFrom, asOf, cycleReadings, cycleVolume, cycleAmount);
+    }
+
+    // Snapshot of the open cycle; the next reading starts a new one
+    BillingCycleTotals close(int64_t closedAt) {
+        BillingCycleTotals closed = current(closedAt);
+        cycleFrom = 0;
+        cycleReadings = 0;
+        cycleVolume = 0;
+        cycleAmount = Money();
+        return closed;
+    }
+
+    BillingCycleTotals lifetime(int64_t asOf) const {
+        return totals(allFrom, asOf, allReadings, allVolume, allAmount);
+    }
+
+private:
+    int64_t cycleFrom = 0;
+    uint64_t cycleReadings = 0;
+    int64_t cycleVolume = 0;      // thousandths
+    Money cycleAmount;
+    int64_t allFrom = 0;
+    uint64_t allReadings = 0;
+    int64_t allVolume = 0;
+    Money allAmount;
+
+    static BillingCycleTotals totals(int64_t from, int64_t to, uint64_t readings, int64_t volume, Money amount) {
+        BillingCycleTotals t;
+        t.from = from;
+        t.to = to;
+        t.readings = readings;
+        t.volume = volume / 1000.0;
+        t.amount = amount;
+        return t;
+    }
+};
+
+// Function to turn a date such as "10-Jan-2025" into a day number (days since 1-Jan-1970), so due dates
+// compare and subtract as integers; false if it is not a real calendar date
+bool parseDay(string_view text, int32_t& day)
+{
+    static const char months[] = "janfebmaraprmayjunjulaugsepoctnovdec";
+    size_t first = text.find('-');
+    size_t second = first == string_view::npos ? string_view::npos : text.find('-', first + 1);
+    if (second == string_view::npos || second - first != 4)
+        return false;
+
+    int d = 0, m = 0, y = 0;
+    const char* end = text.data() + first;
+    if (from_chars(text.data(), end, d).ptr != end)
+        return false;
+    end = text.data() + text.size();
+    if (from_chars(text.data() + second + 1, end, y).ptr != end || y < 1900 || y > 9999)
+        return false;
+    for (int i = 0; i < 12 && m == 0; ++i)
+        if (tolower((unsigned char)text[first + 1]) == months[i * 3] && tolower((unsigned char)text[first + 2]) == months[i * 3 + 1]
+            && tolower((unsigned char)text[first + 3]) == months[i * 3 + 2])
+            m = i + 1;
+    static const int monthDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    if (m == 0 || d < 1 || d > monthDays[m - 1] + (m == 2 && leap))
+        return false;
+
+    // Days from the civil date (proleptic Gregorian, years counted from March)
+    int yearFromMarch = y - (m <= 2);
+    int era = yearFromMarch / 400;
+    int yearOfEra = yearFromMarch - era * 400;
+    int dayOfYear = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    day = era * 146097 + dayOfEra - 719468;
+    return true;
+}
+
+// Function to format a day number as e.g. "10-Jan-2025"
+string formatDay(int32_t day)
+{
+    return formatTimestamp((int64_t)day * 86400).substr(0, 11);
+}
+
+// Function to get today's day number (UTC)
+int32_t currentDay()
+{
+    return (int32_t)(time(NULL) / 86400);
+}
+
+// Structure to report a receivables aging run: the open bills by days past due and their penalties
+struct AgingReport {
+    enum Bucket { Current, Days30, Days60, Days90, Over90, BUCKETS };   // not yet due, 1-30, 31-60, 61-90, 90+
+    static constexpr const char* LABELS[BUCKETS] = {"Current", "1-30 days", "31-60 days", "61-90 days", "Over 90 days"};
+
+    int32_t asOf = 0;
+    size_t bills[BUCKETS] = {};
+    Money amount[BUCKETS];
+    Money penalties;        // owed on the overdue bills as of asOf
+    Money newPenalties;     // added by this run
+    double milliseconds = 0;
+
+    static Bucket bucketOf(int32_t daysPastDue) {
+        if (daysPastDue <= 0)
+            return Current;
+        return daysPastDue <= 30 ? Days30 : daysPastDue <= 60 ? Days60 : daysPastDue <= 90 ? Days90 : Over90;
+    }
+
+    AgingReport& operator+=(const AgingReport& other) {
+        for (int b = 0; b < BUCKETS; ++b) {
+            bills[b] += other.bills[b];
+            amount[b] += other.amount[b];
+        }
+        penalties += other.penalties;
+        newPenalties += other.newPenalties;
+        return *this;
+    }
+
+    void display() const {
+        BlockWriter out(stdout);
+        TextBuffer& text = out.text();
+        text << "Receivables aging as of " << formatDay(asOf) << '\n';
+        for (int b = 0; b < BUCKETS; ++b)
+            text << "  " << LABELS[b] << ": " << bills[b] << " bill(s), " << amount[b] << " rupees\n";
+        text << "  Penalties owed: " << penalties << " rupees (" << newPenalties << " added by this run)\n";
+    }
+};
+
+// Name of the file holding the open gas bills between runs, in the working directory
+const char* const GAS_RECEIVABLES_FILE = "gas_receivables.txt";
+
+// Class to hold the unpaid bills of a utility and age them. Due dates are parsed into day numbers when a
+// bill is added, and bills are indexed in one bucket per due day, oldest first, so the nightly job only
+// visits the bills that are past due: the days are shared out among worker threads, and every bill of a
+// day has the same age, aging bucket and number of months late. The penalty is the monthly rate on the
+// bill amount for each started month past due after the grace days; it is recomputed from the age rather
+// than added on, so running the job twice for the same night charges nothing extra.
+// Paid bills are dropped from their day's bucket by the next run. add(), settle() and age() must not run
+// at the same time; the lookups may. The index holds one bucket per day from the oldest due day to the
+// newest, so the due days of the open bills may span at most MAX_SPAN_DAYS.
+class Receivables {
+public:
+    static const uint32_t NO_BILL = UINT32_MAX;
+    static const int32_t MAX_SPAN_DAYS = 3660;   // about ten years
+
+    explicit Receivables(Percentage monthlyPenalty = Percentage(), int graceDays = 0)
+        : penaltyRate(monthlyPenalty), grace(graceDays) {}
+
+    // Adds an unpaid bill and returns its bill number; NO_BILL if the due day is more than
+    // MAX_SPAN_DAYS from the due days already indexed
+    uint32_t add(int32_t dueDay, Money amount) {
+        if (!byDueDay.empty()) {
+            int32_t lastDay = firstDay + (int32_t)byDueDay.size() - 1;
+            if (dueDay < lastDay - MAX_SPAN_DAYS || dueDay > firstDay + MAX_SPAN_DAYS)
+                return NO_BILL;
+        }
+        uint32_t bill = (uint32_t)dueDays.size();
+        dueDays.push_back(dueDay);
+        customers.push_back(string());
+        amounts.push_back(amount);
+        penalties.push_back(Money());
+        open.push_back(1);
+        openCount++;
+        openAmount += amount;
+
+        if (byDueDay.empty())
+            firstDay = dueDay;
+        while (dueDay < firstDay) {
+            byDueDay.emplace_front();
+            firstDay--;
+        }
+        if ((size_t)(dueDay - firstDay) >= byDueDay.size())
+            byDueDay.resize(dueDay - firstDay + 1);
+        byDueDay[dueDay - firstDay].push_back(bill);
+        return bill;
+    }
+
+    // Adds a bill with a due date such as "10-Jan-2025"; NO_BILL if the date is not valid
+    uint32_t add(string_view dueDate, Money amount) {
+        int32_t day;
+        return parseDay(dueDate, day) ? add(day, amount) : NO_BILL;
+    }
+
+    // Adds an unpaid bill of a customer; NO_BILL if the customer already has an open bill due that day
+    // (billOf finds it), or if add(dueDay, amount) would refuse it
+    uint32_t add(const string& customer, int32_t dueDay, Money amount) {
+        string key = billKey(customer, dueDay);
+        if (openByKey.count(key))
+            return NO_BILL;
+        uint32_t bill = add(dueDay, amount);
+        if (bill != NO_BILL) {
+            customers[bill] = customer;
+            openByKey.emplace(key, bill);
+        }
+        return bill;
+    }
+
+    // The open bill of a customer due on a day, or NO_BILL
+    uint32_t billOf(const string& customer, int32_t dueDay) const {
+        auto found = openByKey.find(billKey(customer, dueDay));
+        return found == openByKey.end() ? NO_BILL : found->second;
+    }
+
+    // Adds the open bills saved by save(), one "C0101 10-Jan-2025 1180.00" (customer ID, due date, amount)
+    // per line; '#' starts a comment. False if the file cannot be read; lines that are malformed, repeat
+    // a customer's due date or are out of the window are counted in skipped.
+    bool load(const string& path, size_t& skipped) {
+        FILE* in = fopen(path.c_str(), "rb");
+        if (!in)
+            return false;
+        string line;
+        for (int ch = 0; ch != EOF;) {
+            line.clear();
+            while ((ch = fgetc(in)) != EOF && ch != '\n')
+                line += (char)ch;
+            size_t hash = line.find('#');
+            if (hash != string::npos)
+                line.erase(hash);
+            istringstream words(line);
+            string customer, dueDate, extra;
+            Money amount;
+            int32_t dueDay;
+            if (!(words >> customer))
+                continue;
+            if (!(words >> dueDate >> amount) || words >> extra || !parseDay(dueDate, dueDay) || amount <= Money()
+                || add(customer, dueDay, amount) == NO_BILL)
+                skipped++;
+        }
+        fclose(in);
+        return true;
+    }
+
+    // Writes the open bills for load(), replacing the file only once the new one is complete
+    bool save(const string& path) const {
+        string tmpPath = path + ".tmp";
+        FILE* out = fopen(tmpPath.c_str(), "wb");
+        if (!out)
+            return false;
+        TextBuffer text;
+        text << "# customer ID, due date, amount (rupees) of every open bill\n";
+        for (uint32_t bill = 0; bill < open.size(); ++bill)
+            if (open[bill])
+                text << (customers[bill].empty() ? "-" : customers[bill]) << ' ' << formatDay(dueDays[bill]) << ' '
+                     << amounts[bill] << '\n';
+        bool ok = fwrite(text.data(), 1, text.size(), out) == text.size();
+        ok = fclose(out) == 0 && ok;
+        if (ok) {
+#ifdef _WIN32
+            remove(path.c_str());
+#endif
+            ok = rename(tmpPath.c_str(), path.c_str()) == 0;
+        }
+        if (!ok)
+            remove(tmpPath.c_str());
+        return ok;
+    }
+
+    // Marks a bill paid; false if there is no such open bill
+    bool settle(uint32_t bill) {
+        if (bill >= open.size() || !open[bill])
+            return false;
+        open[bill] = 0;
+        openCount--;
+        openAmount -= amounts[bill];
+        if (!customers[bill].empty())
+            openByKey.erase(billKey(customers[bill], dueDays[bill]));
+        return true;
+    }
+
+    size_t size() const {
+        return openCount;
+    }
+
+    bool isOpen(uint32_t bill) const {
+        return bill < open.size() && open[bill];
+    }
+
+    int32_t dueDayOf(uint32_t bill) const {
+        return dueDays[bill];
+    }
+
+    Money amountOf(uint32_t bill) const {
+        return amounts[bill];
+    }
+
+    // Penalty as of the last aging run
+    Money penaltyOf(uint32_t bill) const {
+        return penalties[bill];
+    }
+
+    // The nightly job: ages every open bill as of a day and brings its penalty up to date.
+    // threads = 0 uses every hardware thread.
+    AgingReport age(int32_t asOf, int threads = 0) {
+        auto start = chrono::steady_clock::now();
+        size_t pastDue = byDueDay.empty() ? 0 : (size_t)max(0, min<int32_t>(asOf - firstDay, (int32_t)byDueDay.size()));
+        if (threads <= 0)
+            threads = max(1u, thread::hardware_concurrency());
+        threads = (int)max<size_t>(1, min<size_t>(threads, pastDue));
+
+        nextDay = 0;
+        vector<AgingReport> partial(threads);
+        vector<thread> workers;
+        for (int t = 1; t < threads; ++t)
+            workers.push_back(thread([this, &partial, asOf, pastDue, t]() { work(asOf, pastDue, partial[t]); }));
+        work(asOf, pastDue, partial[0]);
+        for (thread& w : workers)
+            w.join();
+
+        AgingReport report;
+        report.asOf = asOf;
+        for (const AgingReport& p : partial)
+            report += p;
+        // Bills not yet due are whatever is open and was not counted above
+        size_t overdueBills = 0;
+        Money overdueAmount;
+        for (int b = AgingReport::Days30; b < AgingReport::BUCKETS; ++b) {
+            overdueBills += report.bills[b];
+            overdueAmount += report.amount[b];
+        }
+        report.bills[AgingReport::Current] = openCount - overdueBills;
+        report.amount[AgingReport::Current] = openAmount - overdueAmount;
+
+        while (!byDueDay.empty() && byDueDay.front().empty()) {
+            byDueDay.pop_front();
+            firstDay++;
+        }
+        report.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        return report;
+    }
+
+private:
+    Percentage penaltyRate;
+    int grace;
+    vector<int32_t> dueDays;     // by bill number
+    vector<string> customers;    // empty for a bill added without a customer
+    vector<Money> amounts;
+    vector<Money> penalties;
+    vector<uint8_t> open;
+    size_t openCount = 0;
+    Money openAmount;
+    int32_t firstDay = 0;                  // due day of byDueDay[0]
+    deque<vector<uint32_t>> byDueDay;      // bill numbers by due day
+    atomic<size_t> nextDay{0};
+    unordered_map<string, uint32_t> openByKey;   // open bills added with a customer, by billKey
+
+    static string billKey(const string& customer, int32_t dueDay) {
+        return customer + ' ' + to_string(dueDay);
+    }
+
+    void work(int32_t asOf, size_t pastDue, AgingReport& report) {
+        for (size_t index; (index = nextDay.fetch_add(1)) < pastDue;) {
+            vector<uint32_t>& bills = byDueDay[index];
+            int32_t daysPastDue = asOf - (firstDay + (int32_t)index);
+            AgingReport::Bucket bucket = AgingReport::bucketOf(daysPastDue);
+            int64_t monthsLate = daysPastDue > grace ? (daysPastDue - grace + 29) / 30 : 0;
+            int64_t points = penaltyRate.basisPoints() * monthsLate;
+
+            size_t kept = 0;
+            for (uint32_t bill : bills) {
+                if (!open[bill])
+                    continue;
+                bills[kept++] = bill;
+                Money penalty = Money::fromPaise(Percentage::applyBasisPoints(amounts[bill].paise(), points));
+                report.newPenalties += penalty - penalties[bill];
+                penalties[bill] = penalty;
+                report.penalties += penalty;
+                report.amount[bucket] += amounts[bill];
+            }
+            report.bills[bucket] += kept;
+            bills.resize(kept);
+        }
+    }
+};
+
+// Structures to list the values of the categorical pipeline and customer fields known up front
+struct PipeMaterialValues {
+    enum Code : uint8_t { None, Steel, PVC, Concrete };
+    static constexpr const char* names[] = {"Steel", "PVC", "Concrete"};
+};
+struct PipeStatusValues {
+    enum Code : uint8_t { None, Active, Inactive, UnderMaintenance };
+    static constexpr const char* names[] = {"Active", "Inactive", "Under Maintenance"};
+};
+struct ScheduleValues {
+    enum Code : uint8_t { None, Weekly, Monthly, Quarterly, Yearly };
+    static constexpr const char* names[] = {"Weekly", "Monthly", "Quarterly", "Yearly"};
+};
+struct LeakDetectionValues {
+    enum Code : uint8_t { None, Ultrasonic, PressureDifferential };
+    static constexpr const char* names[] = {"Ultrasonic", "Pressure Differential"};
+};
+struct SupplyTypeValues {
+    enum Code : uint8_t { None, Regular, Emergency, Standard, Premium };
+    static constexpr const char* names[] = {"Regular", "Emergency", "Standard", "Premium"};
+};
+struct BillingCycleValues {
+    enum Code : uint8_t { None, Monthly, Quarterly, Weekly };
+    static constexpr const char* names[] = {"Monthly", "Quarterly", "Weekly"};
+};
+struct ConnectionTypeValues {
+    enum Code : uint8_t { None, Residential, Commercial };
+    static constexpr const char* names[] = {"Residential", "Commercial"};
+};
+
+typedef Categorical<PipeMaterialValues> PipeMaterial;
+typedef Categorical<PipeStatusValues> PipeStatus;
+typedef Categorical<ScheduleValues> MaintenanceSchedule;
+typedef Categorical<LeakDetectionValues> LeakDetectionType;
+typedef Categorical<SupplyTypeValues> SupplyType;
+typedef Categorical<BillingCycleValues> BillingCycle;
+typedef Categorical<ConnectionTypeValues> ConnectionType;
+
+typedef RateTable<PipeMaterialValues> MaterialRateTable;             // per meter
+typedef TariffGrid<SupplyTypeValues, BillingCycleValues> SupplyPriceGrid;
+typedef ReloadableTariff<SupplyTypeValues, BillingCycleValues> ReloadableSupplyPricing;
+typedef TariffGrid<ConnectionTypeValues, BillingCycleValues> ConnectionPriceGrid;
+
+// Water supply charge per billing cycle, built at compile time
+constexpr SupplyPriceGrid waterSupplyTariff = {
+    {SupplyTypeValues::Regular, BillingCycleValues::Monthly, Money::fromRupees(100)},
+    {SupplyTypeValues::Regular, BillingCycleValues::Quarterly, Money::fromRupees(250)},
+    {SupplyTypeValues::Regular, BillingCycleValues::Weekly, Money::fromRupees(25)},
+    {SupplyTypeValues::Emergency, BillingCycleValues::Monthly, Money::fromRupees(200)},
+    {SupplyTypeValues::Emergency, BillingCycleValues::Quarterly, Money::fromRupees(500)},
+    {SupplyTypeValues::Emergency, BillingCycleValues::Weekly, Money::fromRupees(50)},
+};
+
+// Electricity connection charge per billing cycle, built at compile time
+constexpr ConnectionPriceGrid electricityConnectionTariff = {
+    {ConnectionTypeValues::Residential, BillingCycleValues::Monthly, Money::fromRupees(1000)},
+    {ConnectionTypeValues::Residential, BillingCycleValues::Quarterly, Money::fromRupees(2500)},
+    {ConnectionTypeValues::Residential, BillingCycleValues::Weekly, Money::fromRupees(400)},
+    {ConnectionTypeValues::Commercial, BillingCycleValues::Monthly, Money::fromRupees(3000)},
+    {ConnectionTypeValues::Commercial, BillingCycleValues::Quarterly, Money::fromRupees(7500)},
+    {ConnectionTypeValues::Commercial, BillingCycleValues::Weekly, Money::fromRupees(1200)}
+};
+
+// Structure to represent the services one customer takes, with the usage of the billing cycle being invoiced
+struct ServiceAccount {
+    enum Service : uint8_t { Water, Electricity, Gas, WiFi, SERVICES };
+    static constexpr const char* NAMES[SERVICES] = {"Water", "Electricity", "Gas", "Wi-Fi"};
+
+    string customer_id;
+    string name;
+    BillingCycle billing_cycle;
+    uint8_t services = 0;             // one bit per Service
+    SupplyType supply_type;           // water
+    double water_usage = 0;
+    Money water_amount;               // metered water charge, used when there is no slab tariff
+    ConnectionType connection_type;   // electricity
+    double electricity_units = 0;
+    double gas_units = 0;
+    bool wifi_activation = false;     // first Wi-Fi bill, which carries the activation fee
+
+    bool takes(Service service) const {
+        return (services >> service) & 1;
+    }
+
+    void add(Service service) {
+        services |= (uint8_t)(1 << service);
+    }
+};
+
+// Structure to price metered units by slab when a slab tariff is loaded, otherwise at a flat rate per unit
+struct UsagePricing {
+    const SlabTariff* slabs = NULL;
+    Money ratePerUnit;
+
+    Money charge(double units) const {
+        return slabs ? slabs->charge(units) : ratePerUnit.times(units);
+    }
+};
+
+// Tariff plugins for UtilityBilling: each names its service and prices it for one account's billing cycle.
+// Water: usage (by slab, or the metered amount) plus the supply-type / billing-cycle charge
+struct WaterTariff {
+    static constexpr ServiceAccount::Service SERVICE = ServiceAccount::Water;
+    static constexpr const char* NAME = ServiceAccount::NAMES[SERVICE];
+
+    const SupplyPriceGrid* supplyPricing;
+    const SlabTariff* slabs;
+
+    Money charge(const ServiceAccount& account) const {
+        Money usage = slabs ? slabs->charge(account.water_usage) : account.water_amount;
+        return usage + supplyPricing->at(account.supply_type, account.billing_cycle);
+    }
+};
+
+// Electricity: units used plus the connection-type / billing-cycle charge
+struct ElectricityTariff {
+    static constexpr ServiceAccount::Service SERVICE = ServiceAccount::Electricity;
+    static constexpr const char* NAME = ServiceAccount::NAMES[SERVICE];
+
+    const ConnectionPriceGrid* connectionPricing;
+    UsagePricing usage;
+
+    Money charge(const ServiceAccount& account) const {
+        return usage.charge(account.electricity_units) + connectionPricing->at(account.connection_type, account.billing_cycle);
+    }
+};
+
+// Gas: units used plus tax on them
+struct GasTariff {
+    static constexpr ServiceAccount::Service SERVICE = ServiceAccount::Gas;
+    static constexpr const char* NAME = ServiceAccount::NAMES[SERVICE];
+
+    UsagePricing usage;
+    Percentage taxRate;
+
+    Money charge(const ServiceAccount& account) const {
+        Money bill = usage.charge(account.gas_units);
+        return bill + taxRate.of(bill);
+    }
+};
+
+// Wi-Fi: the service fee, plus the activation fee on the first bill
+struct WiFiTariff {
+    static constexpr ServiceAccount::Service SERVICE = ServiceAccount::WiFi;
+    static constexpr const char* NAME = ServiceAccount::NAMES[SERVICE];
+
+    Money serviceFee;
+    Money activationFee;
+
+    Money charge(const ServiceAccount& account) const {
+        return account.wifi_activation ? serviceFee + activationFee : serviceFee;
+    }
+};
+
+// Structure to report a combined billing pass
+struct UtilityBillingReport {
+    size_t invoiced = 0;
+    size_t charges = 0;                              // service lines on the invoices
+    Money byService[ServiceAccount::SERVICES];
+    Money total;
+    double milliseconds = 0;
+
+    double customersPerSecond() const {
+        return milliseconds > 0 ? invoiced / (milliseconds / 1000.0) : 0.0;
+    }
+};
+
+// Class to bill every service a customer takes on one invoice, in a single pass over the accounts.
+// Each service is priced by a tariff plugin (WaterTariff, ElectricityTariff, GasTariff, WiFiTariff, or
+// any type with SERVICE, NAME and charge()). The plugins are template parameters, so the loop over them
+// is unrolled at compile time and a customer's row is read once for all of its services.
+template <typename... Tariffs>
+class UtilityBilling {
+public:
+    explicit UtilityBilling(const Tariffs&... tariffs) : plugins(tariffs...) {}
+
+    // period labels the invoices, e.g. "Oct-2026"
+    UtilityBillingReport run(const vector<ServiceAccount>& accounts, FILE* out, const string& period) const {
+        auto start = chrono::steady_clock::now();
+        UtilityBillingReport report;
+        BlockWriter writer(out);
+        for (const ServiceAccount& account : accounts)
+            bill(account, period, writer.text(), report);
+        if (!writer.flush())
+            cout << "Error: could not write all invoices." << endl;
+        report.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        return report;
+    }
+
+    // Renders one combined invoice; nothing for an account none of the plugins bill
+    void bill(const ServiceAccount& account, const string& period, TextBuffer& out, UtilityBillingReport& report) const {
+        if ((account.services & servicesBilled()) == 0)
+            return;
+        out << "INVOICE " << period << " | " << account.customer_id << " | " << account.name << " | " << account.billing_cycle;
+        Money total;
+        apply([&](const Tariffs&... tariff) { (line(tariff, account, out, total, report), ...); }, plugins);
+        out << " | total " << total << '\n';
+        report.invoiced++;
+        report.total += total;
+    }
+
+private:
+    tuple<Tariffs...> plugins;
+
+    static constexpr uint8_t servicesBilled() {
+        return (uint8_t)(0 | ... | (1 << Tariffs::SERVICE));
+    }
+
+    template <typename Tariff>
+    static void line(const Tariff& tariff, const ServiceAccount& account, TextBuffer& out, Money& total, UtilityBillingReport& report) {
+        if (!account.takes(Tariff::SERVICE))
+            return;
+        Money amount = tariff.charge(account);
+        out << " | " << Tariff::NAME << ' ' << amount;
+        total += amount;
+        report.byService[Tariff::SERVICE] += amount;
+        report.charges++;
+    }
+};
+
+class Pipeline
+
+{
+public:
+
+    int length; // in meters
+    int diameter; // in inches
+    PipeMaterial material; // Steel, PVC, etc.
+    double flow_rate; // in liters per second
+    double pressure; // in Pascals or PSI
+    PipeStatus status; // Active, Inactive, Under Maintenance
+    MaintenanceSchedule maintenance_schedule;
+    double cost; // Cost of the pipeline in currency
+    LeakDetectionType leak_detection_type; // Leak detection type (Ultrasonic or Pressure Differential)
+
+
+    Pipeline(int l, int d, PipeMaterial m, double fr, double p, PipeStatus s, MaintenanceSchedule ms, double c, LeakDetectionType ldt)
+        : length(l),
+        diameter(d),
+        material(m),
+        flow_rate(fr),
+        pressure(p),
+        status(s),
+        maintenance_schedule(ms),
+        cost(c),
+          leak_detection_type(ldt) {}
+
+
+
+    void display() const
+    {
+        BlockWriter out(stdout);
+        render(out.text());
+    }
+
+    void render(TextBuffer &out) const
+    {
+        out << "\nPipeline details: Length = " << length << " meters, Diameter = " << diameter
+            << " inches, Material = " << material << ", Flow Rate = " << flow_rate
+            << " L/s, Pressure = " << pressure << " PSI, Status = " << status
+            << ", Maintenance Schedule = " << maintenance_schedule << ", Cost = " << cost
+            << ", Leak Detection Type = " << leak_detection_type << '\n';
+    }
+
+
+    void updateMaintenanceSchedule(MaintenanceSchedule newSchedule)
+    {
+        maintenance_schedule = newSchedule;
+        cout << "Maintenance schedule updated to: " << newSchedule << endl;
+
+    }
+
+
+};
+
+static_assert(sizeof(Pipeline) < 64, "Pipeline should fit in one cache line");
+
+class Customer
+
+{
+public:
+
+    string name;
+    string address;
+    string customer_id;
+    string location; // Customer's location to calculate distance
+    SupplyType supply_type; // Regular, Emergency
+    BillingCycle billing_cycle; // Monthly, Quarterly, Weekly
+    double total_usage; // Total water usage during billing cycle
+    double total_amount; // Total amount to be paid
+    vector<Pipeline> pipelines; // A customer may have multiple pipelines
+    UsageSeries usage_history; // Meter readings (time, water usage, amount), kept in sharedUsageArena()
+    BillingAccumulator billing_totals; // Running totals of usage_history for the open billing cycle
+    vector<BillingCycleTotals> closed_cycles;
+    bool disconnected = false; // Pipeline disconnected (case 12); kept as a tombstone until compacted
+    string disconnect_reason;
+    int64_t disconnected_at = 0;
+
+
+    // Default constructor
+    Customer()
+        : name(""),
+        address(""),
+        customer_id(""),
+        location(""),
+          supply_type("Regular"),
+          billing_cycle("Monthly"),
+          total_usage(0),
+          total_amount(0) {}
+
+
+    // Parameterized constructor
+    Customer(string n, string addr, string id, string loc, SupplyType supply, BillingCycle cycle, double usage, double amount)
+        : name(n),
+        address(addr),
+        customer_id(id),
+        location(loc),
+        supply_type(supply),
+        billing_cycle(cycle),
+          total_usage(usage),
+          total_amount(amount) {}
+
+
+    void display() const
+    {
+        BlockWriter out(stdout);
+        render(out);
+    }
+
+    // A long usage history is spread over the writer's blocks instead of one buffer
+    void render(BlockWriter &writer) const
+    {
+        writer.text() << "\nCustomer Details: \nName: " << name << "\nAddress: " << address
+                      << "\nCustomer ID: " << customer_id << "\nLocation: " << location
+                      << "\nSupply Type: " << supply_type << "\nBilling Cycle: " << billing_cycle
+                      << "\nTotal Water Usage: " << total_usage << "\nTotal Amount: " << total_amount << '\n';
+        if (disconnected)
+        {
+            writer.text() << "Status: Disconnected on ";
+            writer.text().timestamp(disconnected_at) << ". Reason: " << disconnect_reason << '\n';
+        }
+
+        writer.text() << "\nPipeline Details: \n";
+        for (auto &pipe : pipelines)
+        {
+            pipe.render(writer.text());
+        }
+
+        writer.text() << "\nUsage History: \n";
+        usage_history.forEach(sharedUsageArena(), INT64_MIN, INT64_MAX, [&writer](const UsageReading &r)
+        {
+            writer.text().timestamp(r.timestamp) << ": usage " << r.volume << ", amount " << r.amount << '\n';
+        });
+
+        writer.text() << "\nCurrent Billing Cycle: ";
+        billing_totals.current(time(NULL)).render(writer.text());
+        for (const BillingCycleTotals &cycle : closed_cycles)
+        {
+            writer.text() << "Closed Billing Cycle: ";
+            cycle.render(writer.text());
+        }
+    }
+
+
+
+    void addPipeline(Pipeline p)
+    {
+        pipelines.push_back(p);
+        cout << "New pipeline added for " << name << endl;
+    }
+
+
+
+    void addUsageRecord(int64_t timestamp, double usage, double amount)
+    {
+        if (usage_history.append(sharedUsageArena(), UsageReading{timestamp, usage, amount}))
+        {
+            billing_totals.add(UsageReading{timestamp, usage, amount});
+            cout << "Usage record added: " << formatTimestamp(timestamp) << ", usage " << usage << ", amount " << amount << endl;
+        }
+        else
+        {
+            cout << "Usage reading is older than the last one recorded." << endl;
+        }
+    }
+
+    // Close the open billing cycle at closedAt from the running totals and keep it with the closed ones
+    const BillingCycleTotals& closeBillingCycle(int64_t closedAt)
+    {
+        closed_cycles.push_back(billing_totals.close(closedAt));
+        return closed_cycles.back();
+    }
+
+
+};
+
+// Function to turn a customer ID such as "C0101" into a compact integer key.
+// Up to 3 letters followed by up to 12 digits pack exactly (top bit clear), case included, so
+// "c0101" and "C0101" stay different keys; any other ID is hashed with the top bit set, and
+// such keys are always confirmed against the ID string.
+uint64_t parseCustomerKey(const string& id)
+{
+    size_t letters = 0;
+    while (letters < id.size() && isalpha((unsigned char)id[letters]))
+        ++letters;
+    size_t digits = id.size() - letters;
+    bool packable = letters <= 3 && digits >= 1 && digits <= 12;
+    for (size_t i = letters; packable && i < id.size(); ++i)
+        packable = isdigit((unsigned char)id[i]) != 0;
+
+    if (packable) {
+        uint64_t prefix = 0;
+        for (size_t i = 0; i < letters; ++i)
+            prefix = prefix * 53 + (isupper((unsigned char)id[i]) ? id[i] - 'A' + 1 : id[i] - 'a' + 27);
+        uint64_t number = 0;
+        for (size_t i = letters; i < id.size(); ++i)
+            number = number * 10 + (id[i] - '0');
+        // digit count is kept so that "C01" and "C001" stay different customers
+        return (prefix << 44) | ((uint64_t)digits << 40) | number;
+    }
+
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : id)
+        hash = (hash ^ c) * 1099511628211ULL;
+    return hash | (1ULL << 63);
+}
+
+// Class to index one categorical customer field with a bitmap per distinct value (one bit per store row)
+class BitmapIndex {
+public:
+    StringDictionary values;
+
+    uint32_t add(const string& value, uint32_t row) {
+        uint32_t code = values.encode(value);
+        set(code, row);
+        return code;
+    }
+
+    void set(uint32_t code, uint32_t row) {
+        if (code >= bitmaps.size())
+            bitmaps.resize(code + 1);
+        vector<uint64_t>& bits = bitmaps[code];
+        if (row / 64 >= bits.size())
+            bits.resize(row / 64 + 1, 0);
+        bits[row / 64] |= 1ULL << (row % 64);
+    }
+
+    void clear(uint32_t code, uint32_t row) {
+        vector<uint64_t>& bits = bitmaps[code];
+        if (row / 64 < bits.size())
+            bits[row / 64] &= ~(1ULL << (row % 64));
+    }
+
+    // Bitmap of the rows holding the value, or NULL if no row ever had it
+    const vector<uint64_t>* rowsWith(const string& value) const {
+        int64_t code = values.find(value);
+        return code < 0 ? NULL : &bitmaps[code];
+    }
+
+private:
+    vector<vector<uint64_t>> bitmaps;
+};
+
+// Function to split [0, n) into one chunk per thread, run kernel(begin, end) on each and add the results
+template <typename Result, typename Kernel>
+Result parallelReduce(size_t n, int threads, Kernel kernel)
+{
+    if (threads <= 0)
+        threads = max(1u, thread::hardware_concurrency());
+    if (threads == 1 || n < 65536)
+        return kernel((size_t)0, n);
+
+    vector<Result> partial(threads, Result());
+    vector<thread> workers;
+    size_t chunk = (n + threads - 1) / threads;
+    for (int t = 0; t < threads; ++t) {
+        size_t begin = min(n, t * chunk), end = min(n, begin + chunk);
+        workers.push_back(thread([&partial, &kernel, t, begin, end]() {
+            partial[t] = kernel(begin, end);
+        }));
+    }
+    Result total = Result();
+    for (int t = 0; t < threads; ++t) {
+        workers[t].join();
+        total += partial[t];
+    }
+    return total;
+}
+
+// Function to add up a column of doubles
+double sumColumn(const double* values, size_t n)
+{
+    size_t i = 0;
+    double total = 0;
+#ifdef __AVX2__
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(values + i));
+        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(values + i + 4));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+    total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+    for (; i < n; ++i)
+        total += values[i];
+    return total;
+}
+
+// Function to add up a column of doubles over the rows whose code equals code
+double sumColumnWhere(const double* values, const uint32_t* codes, uint32_t code, size_t n)
+{
+    size_t i = 0;
+    double total = 0;
+#ifdef __AVX2__
+    __m256d acc = _mm256_setzero_pd();
+    __m128i wanted = _mm_set1_epi32((int)code);
+    for (; i + 4 <= n; i += 4) {
+        __m128i match = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(codes + i)), wanted);
+        __m256d mask = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(match));
+        acc = _mm256_add_pd(acc, _mm256_and_pd(mask, _mm256_loadu_pd(values + i)));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+    for (; i < n; ++i)
+        total += codes[i] == code ? values[i] : 0.0;
+    return total;
+}
+
+// Function to count the rows of a column above a threshold
+size_t countColumnAbove(const double* values, double threshold, size_t n)
+{
+    size_t i = 0, count = 0;
+#ifdef __AVX2__
+    __m256d limit = _mm256_set1_pd(threshold);
+    for (; i + 4 <= n; i += 4) {
+        int bits = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(values + i), limit, _CMP_GT_OQ));
+        count += __builtin_popcount(bits);
+    }
+#endif
+    for (; i < n; ++i)
+        count += values[i] > threshold ? 1 : 0;
+    return count;
+}
+
+// Class to mirror the customer table column by column (struct of arrays) for bulk analytics.
+// Row i of every column is row i of the CustomerStore that owns it; the code columns hold
+// dictionary codes from CustomerStore::locations(), supplyTypes() and billingCycles().
+class CustomerColumns {
+public:
+    // Code of every column for the row of a disconnected customer, whose usage and amount read 0
+    static const uint32_t TOMBSTONE = UINT32_MAX;
+
+    vector<double> usage;         // total_usage
+    vector<double> amount;        // total_amount
+    vector<uint32_t> location;
+    vector<uint32_t> supplyType;
+    vector<uint32_t> billingCycle;
+
+    size_t size() const {
+        return amount.size();
+    }
+
+    void resize(size_t n) {
+        usage.resize(n);
+        amount.resize(n);
+        location.resize(n);
+        supplyType.resize(n);
+        billingCycle.resize(n);
+    }
+
+    void reserve(size_t n) {
+        usage.reserve(n);
+        amount.reserve(n);
+        location.reserve(n);
+        supplyType.reserve(n);
+        billingCycle.reserve(n);
+    }
+
+    void copyRow(size_t to, size_t from) {
+        usage[to] = usage[from];
+        amount[to] = amount[from];
+        location[to] = location[from];
+        supplyType[to] = supplyType[from];
+        billingCycle[to] = billingCycle[from];
+    }
+
+    void popBack() {
+        resize(size() - 1);
+    }
+
+    // threads = 0 uses every hardware thread
+    double totalUsage(int threads = 0) const {
+        const double* v = usage.data();
+        return parallelReduce<double>(size(), threads, [v](size_t b, size_t e) { return sumColumn(v + b, e - b); });
+    }
+
+    double totalAmount(int threads = 0) const {
+        const double* v = amount.data();
+        return parallelReduce<double>(size(), threads, [v](size_t b, size_t e) { return sumColumn(v + b, e - b); });
+    }
+
+    // e.g. sumWhere(amount, supplyType, code of "Emergency")
+    double sumWhere(const vector<double>& values, const vector<uint32_t>& codes, uint32_t code, int threads = 0) const {
+        const double* v = values.data();
+        const uint32_t* c = codes.data();
+        return parallelReduce<double>(size(), threads, [v, c, code](size_t b, size_t e) {
+            return sumColumnWhere(v + b, c + b, code, e - b);
+        });
+    }
+
+    size_t countAbove(const vector<double>& values, double threshold, int threads = 0) const {
+        const double* v = values.data();
+        return parallelReduce<size_t>(size(), threads, [v, threshold](size_t b, size_t e) {
+            return countColumnAbove(v + b, threshold, e - b);
+        });
+    }
+};
+
+// Class to store customers contiguously with an open-addressing (Robin Hood) index on the parsed ID.
+// Lookups touch one cache line of the index and then the customer; erase swaps the last customer into the hole.
+class CustomerStore {
+public:
+    CustomerStore() {
+        rehash(64);
+    }
+
+    // Including disconnected customers not compacted yet
+    size_t size() const {
+        return customers.size();
+    }
+
+    size_t liveSize() const {
+        return customers.size() - tombstones;
+    }
+
+    // Reserve room for n customers up front so a bulk load does not reallocate
+    void reserve(size_t n) {
+        customers.reserve(n);
+        cols.reserve(n);
+        size_t needed = 64;
+        while (needed * 7 / 8 < n)
+            needed *= 2;
+        if (needed > capacity())
+            rehash(needed);
+    }
+
+    // Adds the customer, or replaces the one with the same ID; returns true if it was new.
+    // Also the way to change location, supply type or billing cycle, so the indexes follow.
+    bool insert(const Customer& c) {
+        uint64_t key = parseCustomerKey(c.customer_id);
+        int64_t slot = findSlot(key, c.customer_id);
+        if (slot >= 0) {
+            uint32_t row = rows[slot];
+            unindexRow(row);
+            customers[row] = c;
+            indexRow(row);
+            return false;
+        }
+        if ((customers.size() + 1) * 8 > capacity() * 7)
+            rehash(capacity() * 2);
+        customers.push_back(c);
+        place(key, (uint32_t)customers.size() - 1);
+        indexRow((uint32_t)customers.size() - 1);
+        return true;
+    }
+
+    // Adds many customers at once (IDs assumed unique), growing the storage only once.
+    // Tombstones arrive in row order here, so the compaction queue is sorted once at the end.
+    void bulkLoad(vector<Customer>& batch) {
+        reserve(customers.size() + batch.size());
+        size_t queued = tombstoneQueue.size();
+        for (Customer& c : batch) {
+            uint64_t key = parseCustomerKey(c.customer_id);
+            customers.push_back(move(c));
+            place(key, (uint32_t)customers.size() - 1);
+            indexRow((uint32_t)customers.size() - 1, false);
+        }
+        batch.clear();
+        if (tombstoneQueue.size() > queued)
+            stable_sort(tombstoneQueue.begin(), tombstoneQueue.end(), earlierTombstone);
+    }
+
+    Customer* find(const string& id) {
+        int64_t slot = findSlot(parseCustomerKey(id), id);
+        return slot < 0 ? NULL : &customers[rows[slot]];
+    }
+
+    const Customer* find(const string& id) const {
+        int64_t slot = findSlot(parseCustomerKey(id), id);
+        return slot < 0 ? NULL : &customers[rows[slot]];
+    }
+
+    bool erase(const string& id) {
+        int64_t slot = findSlot(parseCustomerKey(id), id);
+        if (slot < 0)
+            return false;
+        uint32_t row = rows[slot];
+        removeSlot((size_t)slot);
+        unindexRow(row);
+
+        uint32_t last = (uint32_t)customers.size() - 1;
+        if (row != last) {
+            const Customer& moved = customers[last];
+            rows[findSlot(parseCustomerKey(moved.customer_id), moved.customer_id)] = row;
+            clearBits(last);
+            customers[row] = move(customers[last]);
+            cols.copyRow(row, last);
+            setBits(row);
+        }
+        customers.pop_back();
+        cols.popBack();
+        return true;
+    }
+
+    // Soft-delete: keep the customer with the reason and time, but take it out of the bitmaps and
+    // the column aggregates. False if the customer is unknown or already disconnected.
+    bool disconnect(const string& id, const string& reason, int64_t timestamp) {
+        int64_t slot = findSlot(parseCustomerKey(id), id);
+        if (slot < 0 || customers[rows[slot]].disconnected)
+            return false;
+        uint32_t row = rows[slot];
+        unindexRow(row);
+        customers[row].disconnected = true;
+        customers[row].disconnect_reason = reason;
+        customers[row].disconnected_at = timestamp;
+        indexRow(row);
+        return true;
+    }
+
+    // Erase up to batch customers disconnected at or before cutoff, oldest first; their IDs are
+    // added to erased. Each erase is O(1), so a caller can spread a mass disconnection over many batches.
+    size_t compactTombstones(size_t batch, int64_t cutoff, vector<string>& erased) {
+        size_t done = 0;
+        while (done < batch && !tombstoneQueue.empty() && tombstoneQueue.front().first <= cutoff) {
+            pair<int64_t, string> next = move(tombstoneQueue.front());
+            tombstoneQueue.pop_front();
+            const Customer* c = find(next.second);
+            // Skip entries for customers that were re-added or disconnected again since
+            if (c && c->disconnected && c->disconnected_at == next.first) {
+                erase(next.second);
+                erased.push_back(next.second);
+                done++;
+            }
+        }
+        return done;
+    }
+
+    size_t tombstoneCount() const {
+        return tombstones;
+    }
+
+    // Customers matching every non-empty predicate (empty string = any value),
+    // answered by AND-ing the location, supply type and billing cycle bitmaps
+    vector<const Customer*> query(const string& location, const string& supplyType, const string& billingCycle) const {
+        vector<const Customer*> result;
+        forEachMatch(location, supplyType, billingCycle, [&](uint32_t row) {
+            result.push_back(&customers[row]);
+        });
+        return result;
+    }
+
+    size_t count(const string& location, const string& supplyType, const string& billingCycle) const {
+        size_t matches = 0;
+        forEachMatchWord(location, supplyType, billingCycle, [&](size_t, uint64_t word) {
+            matches += __builtin_popcountll(word);
+        });
+        return matches;
+    }
+
+    // Columnar mirror of the table for aggregations and filters
+    const CustomerColumns& columns() const {
+        return cols;
+    }
+
+    const StringDictionary& locations() const {
+        return byLocation.values;
+    }
+    const StringDictionary& supplyTypes() const {
+        return bySupplyType.values;
+    }
+    const StringDictionary& billingCycles() const {
+        return byBillingCycle.values;
+    }
+
+    // Customer in a row (rows are what the columns and query results refer to)
+    const Customer& at(size_t row) const {
+        return customers[row];
+    }
+
+    vector<Customer>::iterator begin() {
+        return customers.begin();
+    }
+    vector<Customer>::iterator end() {
+        return customers.end();
+    }
+    vector<Customer>::const_iterator begin() const {
+        return customers.begin();
+    }
+    vector<Customer>::const_iterator end() const {
+        return customers.end();
+    }
+
+private:
+    BitmapIndex byLocation;
+    BitmapIndex bySupplyType;
+    BitmapIndex byBillingCycle;
+    CustomerColumns cols;         // also holds the indexed codes of each row, as they were when indexed
+    size_t tombstones = 0;
+    deque<pair<int64_t, string>> tombstoneQueue;   // (disconnected at, ID), oldest first
+
+    static bool earlierTombstone(const pair<int64_t, string>& a, const pair<int64_t, string>& b) {
+        return a.first < b.first;
+    }
+
+    // Copy the customer of a row into the columns and the bitmaps; a disconnected one only gets
+    // TOMBSTONE codes and is queued for compaction, in disconnected_at order unless ordered is false
+    void indexRow(uint32_t row, bool ordered = true) {
+        const Customer& c = customers[row];
+        if (row >= cols.size())
+            cols.resize(row + 1);
+        if (c.disconnected) {
+            cols.usage[row] = cols.amount[row] = 0;
+            cols.location[row] = cols.supplyType[row] = cols.billingCycle[row] = CustomerColumns::TOMBSTONE;
+            tombstones++;
+            pair<int64_t, string> entry(c.disconnected_at, c.customer_id);
+            if (!ordered || tombstoneQueue.empty() || tombstoneQueue.back().first <= entry.first)
+                tombstoneQueue.push_back(move(entry));
+            else
+                tombstoneQueue.insert(upper_bound(tombstoneQueue.begin(), tombstoneQueue.end(), entry, earlierTombstone),
+                                      move(entry));
+            return;
+        }
+        cols.usage[row] = c.total_usage;
+        cols.amount[row] = c.total_amount;
+        cols.location[row] = byLocation.values.encode(c.location);
+        cols.supplyType[row] = bySupplyType.values.encode(c.supply_type.name());
+        cols.billingCycle[row] = byBillingCycle.values.encode(c.billing_cycle.name());
+        setBits(row);
+    }
+
+    bool tombstoned(uint32_t row) const {
+        return cols.location[row] == CustomerColumns::TOMBSTONE;
+    }
+
+    void setBits(uint32_t row) {
+        if (tombstoned(row))
+            return;
+        byLocation.set(cols.location[row], row);
+        bySupplyType.set(cols.supplyType[row], row);
+        byBillingCycle.set(cols.billingCycle[row], row);
+    }
+
+    void clearBits(uint32_t row) {
+        if (tombstoned(row))
+            return;
+        byLocation.clear(cols.location[row], row);
+        bySupplyType.clear(cols.supplyType[row], row);
+        byBillingCycle.clear(cols.billingCycle[row], row);
+    }
+
+    void unindexRow(uint32_t row) {
+        if (tombstoned(row))
+            tombstones--;
+        clearBits(row);
+    }
+
+    template <typename Visit>
+    void forEachMatchWord(const string& location, const string& supplyType, const string& billingCycle, Visit visit) const {
+        const vector<uint64_t>* filters[3];
+        int filterCount = 0;
+        const BitmapIndex* indexes[3] = {&byLocation, &bySupplyType, &byBillingCycle};
+        const string* values[3] = {&location, &supplyType, &billingCycle};
+        for (int i = 0; i < 3; ++i) {
+            if (values[i]->empty())
+                continue;
+            const vector<uint64_t>* bits = indexes[i]->rowsWith(*values[i]);
+            if (!bits)
+                return;
+            filters[filterCount++] = bits;
+        }
+
+        size_t words = (customers.size() + 63) / 64;
+        for (int f = 0; f < filterCount; ++f)
+            words = min(words, filters[f]->size());
+        for (size_t w = 0; w < words; ++w) {
+            uint64_t word = ~0ULL;
+            if (w == (customers.size() + 63) / 64 - 1 && customers.size() % 64 != 0)
+                word = (1ULL << (customers.size() % 64)) - 1;
+            for (int f = 0; f < filterCount; ++f)
+                word &= (*filters[f])[w];
+            // With no bitmap to AND, tombstoned rows have to be left out here
+            for (uint64_t bits = filterCount == 0 && tombstones > 0 ? word : 0; bits; bits &= bits - 1) {
+                int bit = __builtin_ctzll(bits);
+                if (tombstoned((uint32_t)(w * 64 + bit)))
+                    word &= ~(1ULL << bit);
+            }
+            if (word)
+                visit(w, word);
+        }
+    }
+
+    template <typename Visit>
+    void forEachMatch(const string& location, const string& supplyType, const string& billingCycle, Visit visit) const {
+        forEachMatchWord(location, supplyType, billingCycle, [&](size_t w, uint64_t word) {
+            while (word) {
+                visit((uint32_t)(w * 64 + __builtin_ctzll(word)));
+                word &= word - 1;
+            }
+        });
+    }
+
+    vector<Customer> customers;   // rows, in no particular order
+    vector<uint64_t> keys;        // parsed ID of each index slot
+    vector<uint32_t> rows;        // row in customers of each index slot
+    vector<uint8_t> probe;        // 0 = empty, otherwise distance from the home slot + 1
+    size_t mask = 0;
+
+    size_t capacity() const {
+        return keys.size();
+    }
+
+    static size_t mix(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return (size_t)key;
+    }
+
+    int64_t findSlot(uint64_t key, const string& id) const {
+        size_t slot = mix(key) & mask;
+        for (uint8_t d = 1;; ++d, slot = (slot + 1) & mask) {
+            // Robin Hood invariant: once we pass a slot poorer than us, the key is not present
+            if (probe[slot] < d)
+                return -1;
+            if (keys[slot] == key && ((key >> 63) == 0 || customers[rows[slot]].customer_id == id))
+                return (int64_t)slot;
+        }
+    }
+
+    void place(uint64_t key, uint32_t row) {
+        size_t slot = mix(key) & mask;
+        uint8_t d = 1;
+        for (;; ++d, slot = (slot + 1) & mask) {
+            if (probe[slot] == 0) {
+                keys[slot] = key;
+                rows[slot] = row;
+                probe[slot] = d;
+                return;
+            }
+            if (probe[slot] < d) {
+                swap(keys[slot], key);
+                swap(rows[slot], row);
+                swap(probe[slot], d);
+            }
+            if (d == 255) {
+                // pathological clustering: grow and start over with the evicted entry
+                rehash(capacity() * 2);
+                place(key, row);
+                return;
+            }
+        }
+    }
+
+    // Backward-shift deletion keeps probe sequences short without tombstones
+    void removeSlot(size_t slot) {
+        size_t next = (slot + 1) & mask;
+        while (probe[next] > 1) {
+            keys[slot] = keys[next];
+            rows[slot] = rows[next];
+            probe[slot] = probe[next] - 1;
+            slot = next;
+            next = (next + 1) & mask;
+        }
+        probe[slot] = 0;
+    }
+
+    void rehash(size_t newCapacity) {
+        vector<uint64_t> oldKeys;
+        vector<uint32_t> oldRows;
+        vector<uint8_t> oldProbe;
+        oldKeys.swap(keys);
+        oldRows.swap(rows);
+        oldProbe.swap(probe);
+        keys.assign(newCapacity, 0);
+        rows.assign(newCapacity, 0);
+        probe.assign(newCapacity, 0);
+        mask = newCapacity - 1;
+        for (size_t i = 0; i < oldKeys.size(); ++i)
+            if (oldProbe[i] != 0)
+                place(oldKeys[i], oldRows[i]);
+    }
+};
+
+// Class to run filter expressions such as
+//   total_amount > 20000 AND billing_cycle = Quarterly
+//   (location = 'Udyambag' OR location = Tilakwadi) AND NOT supply_type = Premium
+// over the columnar mirror of a CustomerStore. The expression is compiled into a tree of predicates
+// that run a batch of rows at a time: each one narrows a selection vector of row numbers, AND feeds
+// the survivors of one predicate into the next, and customers are only looked up (late
+// materialization) for the rows of the page being returned.
+class CustomerQuery {
+public:
+    static constexpr size_t BATCH = 2048;
+
+    CustomerQuery(const CustomerStore& customers) : store(customers) {}
+
+    // False on a syntax error, see error()
+    bool compile(const string& expression) {
+        nodes.clear();
+        text = expression;
+        at = 0;
+        problem.clear();
+        int root = parseOr();
+        skipSpaces();
+        if (problem.empty() && at < text.size())
+            fail("unexpected \"" + text.substr(at) + "\"");
+        if (!problem.empty()) {
+            nodes.clear();
+            return false;
+        }
+        // Disconnected customers are never returned
+        if (store.tombstoneCount() > 0) {
+            Node live;
+            live.kind = CODE;
+            live.op = NE;
+            live.column = 0;
+            live.code = CustomerColumns::TOMBSTONE;
+            nodes.push_back(live);
+            root = combine(AND, (int)nodes.size() - 1, root);
+        }
+        rootNode = root;
+        for (Node& node : nodes)
+            node.scratch.resize(BATCH);
+        rewind();
+        return true;
+    }
+
+    const string& error() const {
+        return problem;
+    }
+
+    // Start returning pages from the first row again
+    void rewind() {
+        nextRow = 0;
+        pending.clear();
+        pendingAt = 0;
+    }
+
+    // Next page of up to pageSize matches; false once there are none left
+    bool nextPage(size_t pageSize, vector<const Customer*>& page) {
+        page.clear();
+        while (page.size() < pageSize) {
+            if (pendingAt == pending.size() && !scanBatch())
+                break;
+            while (pendingAt < pending.size() && page.size() < pageSize)
+                page.push_back(&store.at(pending[pendingAt++]));
+        }
+        return !page.empty();
+    }
+
+    // Number of matching rows, without materializing any customer
+    size_t count() {
+        size_t matches = 0;
+        size_t rows = store.columns().size();
+        for (size_t begin = 0; begin < rows; begin += BATCH)
+            matches += evaluate(rootNode, begin, NULL, min(BATCH, rows - begin));
+        return matches;
+    }
+
+private:
+    enum Kind { AND, OR, NOT, NUMBER, CODE, NOTHING };
+    enum Op { EQ, NE, LT, LE, GT, GE };
+
+    struct Node {
+        Kind kind = NOTHING;
+        Op op = EQ;
+        int column = 0;          // NUMBER: 0 usage, 1 amount; CODE: 0 location, 1 supply type, 2 billing cycle
+        double number = 0;
+        uint32_t code = 0;
+        int left = -1, right = -1;
+        vector<uint32_t> scratch;   // this node's output for the current batch
+    };
+
+    const CustomerStore& store;
+    vector<Node> nodes;
+    int rootNode = -1;
+    string text;
+    size_t at = 0;
+    string problem;
+    size_t nextRow = 0;
+    vector<uint32_t> pending;
+    size_t pendingAt = 0;
+
+    // Parser: or := and (OR and)* ; and := unary (AND unary)* ; unary := NOT unary | '(' or ')' | field op value
+
+    void fail(const string& message) {
+        if (problem.empty())
+            problem = message;
+    }
+
+    void skipSpaces() {
+        while (at < text.size() && isspace((unsigned char)text[at]))
+            ++at;
+    }
+
+    bool keyword(const char* word) {
+        skipSpaces();
+        size_t n = strlen(word);
+        if (text.size() - at < n)
+            return false;
+        for (size_t i = 0; i < n; ++i)
+            if (toupper((unsigned char)text[at + i]) != word[i])
+                return false;
+        if (at + n < text.size() && (isalnum((unsigned char)text[at + n]) || text[at + n] == '_'))
+            return false;
+        at += n;
+        return true;
+    }
+
+    string word() {
+        skipSpaces();
+        size_t start = at;
+        while (at < text.size() && (isalnum((unsigned char)text[at]) || text[at] == '_' || text[at] == '.' || text[at] == '-'))
+            ++at;
+        return text.substr(start, at - start);
+    }
+
+    int combine(Kind kind, int left, int right) {
+        Node node;
+        node.kind = kind;
+        node.left = left;
+        node.right = right;
+        nodes.push_back(node);
+        return (int)nodes.size() - 1;
+    }
+
+    int parseOr() {
+        int left = parseAnd();
+        while (problem.empty() && keyword("OR"))
+            left = combine(OR, left, parseAnd());
+        return left;
+    }
+
+    int parseAnd() {
+        int left = parseUnary();
+        while (problem.empty() && keyword("AND"))
+            left = combine(AND, left, parseUnary());
+        return left;
+    }
+
+    int parseUnary() {
+        if (keyword("NOT"))
+            return combine(NOT, parseUnary(), -1);
+        skipSpaces();
+        if (at < text.size() && text[at] == '(') {
+            ++at;
+            int inner = parseOr();
+            skipSpaces();
+            if (at < text.size() && text[at] == ')')
+                ++at;
+            else
+                fail("missing )");
+            return inner;
+        }
+        return parseComparison();
+    }
+
+    int parseComparison() {
+        Node node;
+        string field = word();
+        if (field == "total_usage" || field == "total_amount") {
+            node.kind = NUMBER;
+            node.column = field == "total_usage" ? 0 : 1;
+        } else if (field == "location" || field == "supply_type" || field == "billing_cycle") {
+            node.kind = CODE;
+            node.column = field == "location" ? 0 : field == "supply_type" ? 1 : 2;
+        } else {
+            fail(field.empty() ? "expected a field name" : "unknown field \"" + field + "\"");
+            return -1;
+        }
+
+        skipSpaces();
+        static const pair<const char*, Op> ops[] = {{"!=", NE}, {"<>", NE}, {"<=", LE}, {">=", GE}, {"=", EQ}, {"<", LT}, {">", GT}};
+        bool found = false;
+        for (const auto& op : ops) {
+            if (text.compare(at, strlen(op.first), op.first) == 0) {
+                node.op = op.second;
+                at += strlen(op.first);
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            fail("expected a comparison after " + field);
+            return -1;
+        }
+
+        skipSpaces();
+        string value;
+        if (at < text.size() && (text[at] == '\'' || text[at] == '"')) {
+            size_t close = text.find(text[at], at + 1);
+            if (close == string::npos) {
+                fail("unterminated quote");
+                return -1;
+            }
+            value = text.substr(at + 1, close - at - 1);
+            at = close + 1;
+        } else {
+            value = word();
+        }
+
+        if (node.kind == NUMBER) {
+            const char* end = value.data() + value.size();
+            if (value.empty() || from_chars(value.data(), end, node.number).ptr != end) {
+                fail(field + " needs a number");
+                return -1;
+            }
+        } else {
+            if (node.op != EQ && node.op != NE) {
+                fail(field + " can only be compared with = or !=");
+                return -1;
+            }
+            const StringDictionary& values = node.column == 0 ? store.locations()
+                                           : node.column == 1 ? store.supplyTypes() : store.billingCycles();
+            int64_t code = values.find(value);
+            if (code < 0) {
+                // Nobody has this value: = matches nothing, != everything
+                if (node.op == EQ) {
+                    node.kind = NOTHING;
+                } else {
+                    node.code = CustomerColumns::TOMBSTONE;
+                }
+            } else {
+                node.code = (uint32_t)code;
+            }
+        }
+        nodes.push_back(node);
+        return (int)nodes.size() - 1;
+    }
+
+    // Executor
+
+    bool scanBatch() {
+        size_t rows = store.columns().size();
+        while (nextRow < rows) {
+            size_t n = min(BATCH, rows - nextRow);
+            size_t matches = evaluate(rootNode, nextRow, NULL, n);
+            nextRow += n;
+            if (matches > 0) {
+                const vector<uint32_t>& out = nodes[rootNode].scratch;
+                pending.assign(out.begin(), out.begin() + matches);
+                pendingAt = 0;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Rows of the batch that satisfy the node, into nodes[node].scratch (ascending); the batch is
+    // either rows [begin, begin + n) (selection NULL) or the n rows listed in selection
+    size_t evaluate(int node, size_t begin, const uint32_t* selection, size_t n) {
+        Node& p = nodes[node];
+        uint32_t* out = p.scratch.data();
+        const CustomerColumns& cols = store.columns();
+        switch (p.kind) {
+        case NOTHING:
+            return 0;
+        case NUMBER: {
+            const double* values = p.column == 0 ? cols.usage.data() : cols.amount.data();
+            switch (p.op) {
+            case EQ: return selectNumber<EQ>(values, p.number, begin, selection, n, out);
+            case NE: return selectNumber<NE>(values, p.number, begin, selection, n, out);
+            case LT: return selectNumber<LT>(values, p.number, begin, selection, n, out);
+            case LE: return selectNumber<LE>(values, p.number, begin, selection, n, out);
+            case GT: return selectNumber<GT>(values, p.number, begin, selection, n, out);
+            default: return selectNumber<GE>(values, p.number, begin, selection, n, out);
+            }
+        }
+        case CODE: {
+            const uint32_t* codes = p.column == 0 ? cols.location.data()
+                                  : p.column == 1 ? cols.supplyType.data() : cols.billingCycle.data();
+            return p.op == EQ ? selectCode<true>(codes, p.code, begin, selection, n, out)
+                              : selectCode<false>(codes, p.code, begin, selection, n, out);
+        }
+        case AND: {
+            // The right side only looks at the rows the left side kept
+            size_t kept = evaluate(p.left, begin, selection, n);
+            if (kept == 0)
+                return 0;
+            kept = evaluate(p.right, begin, nodes[p.left].scratch.data(), kept);
+            copy(nodes[p.right].scratch.begin(), nodes[p.right].scratch.begin() + kept, out);
+            return kept;
+        }
+        case OR: {
+            size_t a = evaluate(p.left, begin, selection, n);
+            size_t b = evaluate(p.right, begin, selection, n);
+            const uint32_t* x = nodes[p.left].scratch.data();
+            const uint32_t* y = nodes[p.right].scratch.data();
+            return set_union(x, x + a, y, y + b, out) - out;
+        }
+        case NOT: {
+            size_t excluded = evaluate(p.left, begin, selection, n);
+            const uint32_t* x = nodes[p.left].scratch.data();
+            size_t k = 0, j = 0;
+            for (size_t i = 0; i < n; ++i) {
+                uint32_t row = selection ? selection[i] : (uint32_t)(begin + i);
+                while (j < excluded && x[j] < row)
+                    ++j;
+                if (j == excluded || x[j] != row)
+                    out[k++] = row;
+            }
+            return k;
+        }
+        }
+        return 0;
+    }
+
+    template <int O>
+    static bool compare(double value, double constant) {
+        return O == EQ ? value == constant : O == NE ? value != constant : O == LT ? value < constant
+             : O == LE ? value <= constant : O == GT ? value > constant : value >= constant;
+    }
+
+    template <int O>
+    static size_t selectNumber(const double* values, double constant, size_t begin, const uint32_t* selection, size_t n, uint32_t* out) {
+        size_t k = 0, i = 0;
+        if (selection) {
+            // Branch-free: always write the row, only advance when it matches
+            for (; i < n; ++i) {
+                out[k] = selection[i];
+                k += compare<O>(values[selection[i]], constant);
+            }
+            return k;
+        }
+#ifdef __AVX2__
+        __m256d c = _mm256_set1_pd(constant);
+        for (; i + 4 <= n; i += 4) {
+            __m256d v = _mm256_loadu_pd(values + begin + i);
+            __m256d hit = O == EQ ? _mm256_cmp_pd(v, c, _CMP_EQ_OQ) : O == NE ? _mm256_cmp_pd(v, c, _CMP_NEQ_UQ)
+                        : O == LT ? _mm256_cmp_pd(v, c, _CMP_LT_OQ) : O == LE ? _mm256_cmp_pd(v, c, _CMP_LE_OQ)
+                        : O == GT ? _mm256_cmp_pd(v, c, _CMP_GT_OQ) : _mm256_cmp_pd(v, c, _CMP_GE_OQ);
+            unsigned mask = (unsigned)_mm256_movemask_pd(hit);
+            while (mask) {
+                out[k++] = (uint32_t)(begin + i + __builtin_ctz(mask));
+                mask &= mask - 1;
+            }
+        }
+#endif
+        for (; i < n; ++i) {
+            out[k] = (uint32_t)(begin + i);
+            k += compare<O>(values[begin + i], constant);
+        }
+        return k;
+    }
+
+    template <bool Equal>
+    static size_t selectCode(const uint32_t* codes, uint32_t code, size_t begin, const uint32_t* selection, size_t n, uint32_t* out) {
+        size_t k = 0, i = 0;
+        if (selection) {
+            for (; i < n; ++i) {
+                out[k] = selection[i];
+                k += (codes[selection[i]] == code) == Equal;
+            }
+            return k;
+        }
+#ifdef __AVX2__
+        __m256i c = _mm256_set1_epi32((int)code);
+        for (; i + 8 <= n; i += 8) {
+            __m256i hit = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(codes + begin + i)), c);
+            unsigned mask = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(hit));
+            if (!Equal)
+                mask ^= 0xff;
+            while (mask) {
+                out[k++] = (uint32_t)(begin + i + __builtin_ctz(mask));
+                mask &= mask - 1;
+            }
+        }
+#endif
+        for (; i < n; ++i) {
+            out[k] = (uint32_t)(begin + i);
+            k += (codes[begin + i] == code) == Equal;
+        }
+        return k;
+    }
+};
+
+// Structure to report the outcome of a billing run
+struct BillingReport {
+    size_t invoiced = 0;
+    size_t disconnected = 0;    // not billed
+    size_t withoutTariff = 0;   // supply type / billing cycle pair with no price; billed usage only
+    Money usageCharges;          // exact, so the same whatever the number of threads
+    Money supplyCharges;
+    double milliseconds = 0;
+
+    double customersPerSecond() const {
+        return milliseconds > 0 ? invoiced / (milliseconds / 1000.0) : 0.0;
+    }
+};
+
+// Class to bill every customer of a store in one pass: the rows are cut into chunks that worker
+// threads take in turn, each worker formats the invoices of its chunk into its own (reused) TextBuffer,
+// and chunks are written to the output with one writev each in row order as soon as their turn comes,
+// so the whole run never holds more than one chunk per thread in memory.
+// Invoice = usage charges + the supply-type / billing-cycle charge from the tariff. Usage charges are
+// total_amount, or with a slab tariff the slab charge of total_usage, worked out a chunk at a time from
+// the usage column.
+class BillingRun {
+public:
+    static const size_t CHUNK = 4096;
+
+    BillingRun(const CustomerStore& customerStore, const SupplyPriceGrid& tariff, const SlabTariff* slabs = NULL)
+        : store(customerStore), supplyPricing(tariff), usageTariff(slabs) {}
+
+    // period labels the invoices, e.g. "Oct-2026"; threads = 0 uses every hardware thread
+    BillingReport run(FILE* out, const string& period, int threads = 0) {
+        if (threads <= 0)
+            threads = max(1u, thread::hardware_concurrency());
+        size_t chunks = (store.size() + CHUNK - 1) / CHUNK;
+        threads = (int)max<size_t>(1, min<size_t>(threads, chunks));
+
+        auto start = chrono::steady_clock::now();
+        BlockWriter writer(out);
+        nextChunk = 0;
+        nextToWrite = 0;
+        vector<BillingReport> partial(threads);
+        vector<thread> workers;
+        for (int t = 1; t < threads; ++t)
+            workers.push_back(thread([this, &writer, &period, &partial, chunks, t]() {
+                work(writer, period, chunks, partial[t]);
+            }));
+        work(writer, period, chunks, partial[0]);
+        for (thread& w : workers)
+            w.join();
+        if (!writer.flush())
+            cout << "Error: could not write all invoices." << endl;
+
+        BillingReport report;
+        for (const BillingReport& p : partial) {
+            report.invoiced += p.invoiced;
+            report.disconnected += p.disconnected;
+            report.withoutTariff += p.withoutTariff;
+            report.usageCharges += p.usageCharges;
+            report.supplyCharges += p.supplyCharges;
+        }
+        report.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        return report;
+    }
+
+private:
+    const CustomerStore& store;
+    const SupplyPriceGrid& supplyPricing;
+    const SlabTariff* usageTariff;
+    atomic<size_t> nextChunk{0};
+    size_t nextToWrite = 0;     // guarded by writeMutex
+    mutex writeMutex;
+    condition_variable writeTurn;
+
+    void work(BlockWriter& writer, const string& period, size_t chunks, BillingReport& report) {
+        TextBuffer buffer(CHUNK * 192);
+        vector<Money> usageCharges(CHUNK);
+        for (size_t chunk; (chunk = nextChunk.fetch_add(1)) < chunks;) {
+            buffer.clear();
+            size_t begin = chunk * CHUNK, end = min(store.size(), begin + CHUNK);
+            if (usageTariff)
+                usageTariff->chargeBatch(store.columns().usage.data() + begin, NULL, end - begin, usageCharges.data());
+            for (size_t row = begin; row < end; ++row) {
+                const Customer& c = store.at(row);
+                bill(c, usageTariff ? usageCharges[row - begin] : Money(c.total_amount), period, buffer, report);
+            }
+
+            // Write in chunk order; a thread that finished early waits for the chunks before its own
+            unique_lock<mutex> lock(writeMutex);
+            writeTurn.wait(lock, [this, chunk]() { return nextToWrite == chunk; });
+            writer.write(buffer.data(), buffer.size());
+            nextToWrite++;
+            lock.unlock();
+            writeTurn.notify_all();
+        }
+    }
+
+    void bill(const Customer& c, Money usageCharge, const string& period, TextBuffer& buffer, BillingReport& report) const {
+        if (c.disconnected) {
+            report.disconnected++;
+            return;
+        }
+        if (!supplyPricing.has(c.supply_type, c.billing_cycle))
+            report.withoutTariff++;
+        Money supplyCharge = supplyPricing.at(c.supply_type, c.billing_cycle);
+        report.invoiced++;
+        report.usageCharges += usageCharge;
+        report.supplyCharges += supplyCharge;
+
+        buffer << "INVOICE " << period << " | " << c.customer_id << " | " << c.name << " | " << c.location
+               << " | " << c.supply_type << '/' << c.billing_cycle << " | usage ";
+        buffer.fixed(c.total_usage, 2) << " | usage charges " << usageCharge << " | supply charge " << supplyCharge
+                                       << " | total " << usageCharge + supplyCharge << '\n';
+    }
+};
+
+// Function to checksum a log / snapshot record (FNV-1a)
+uint32_t recordChecksum(const char* data, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i)
+        hash = (hash ^ (uint8_t)data[i]) * 16777619u;
+    return hash;
+}
+
+// Class to encode customers and their pipelines as compact binary records
+class CustomerCodec {
+public:
+    static void putCustomer(string& out, const Customer& c) {
+        putString(out, c.name);
+        putString(out, c.address);
+        putString(out, c.customer_id);
+        putString(out, c.location);
+        putString(out, c.supply_type.name());
+        putString(out, c.billing_cycle.name());
+        putRaw(out, c.total_usage);
+        putRaw(out, c.total_amount);
+        putRaw(out, (uint32_t)c.pipelines.size());
+        for (const Pipeline& p : c.pipelines) {
+            putRaw(out, (int32_t)p.length);
+            putRaw(out, (int32_t)p.diameter);
+            putString(out, p.material.name());
+            putRaw(out, p.flow_rate);
+            putRaw(out, p.pressure);
+            putString(out, p.status.name());
+            putString(out, p.maintenance_schedule.name());
+            putRaw(out, p.cost);
+            putString(out, p.leak_detection_type.name());
+        }
+        putRaw(out, (uint8_t)c.disconnected);
+        if (c.disconnected) {
+            putString(out, c.disconnect_reason);
+            putRaw(out, c.disconnected_at);
+        }
+    }
+
+    // False if the record is truncated
+    static bool getCustomer(const char*& in, const char* end, Customer& c) {
+        string supply, cycle;
+        uint32_t pipelineCount;
+        if (!getString(in, end, c.name) || !getString(in, end, c.address) || !getString(in, end, c.customer_id)
+            || !getString(in, end, c.location) || !getString(in, end, supply) || !getString(in, end, cycle)
+            || !getRaw(in, end, c.total_usage) || !getRaw(in, end, c.total_amount) || !getRaw(in, end, pipelineCount))
+            return false;
+        c.supply_type = supply;
+        c.billing_cycle = cycle;
+        c.pipelines.clear();
+        for (uint32_t i = 0; i < pipelineCount; ++i) {
+            int32_t length, diameter;
+            double flow, pressure, cost;
+            string material, status, schedule, leak;
+            if (!getRaw(in, end, length) || !getRaw(in, end, diameter) || !getString(in, end, material)
+                || !getRaw(in, end, flow) || !getRaw(in, end, pressure) || !getString(in, end, status)
+                || !getString(in, end, schedule) || !getRaw(in, end, cost) || !getString(in, end, leak))
+                return false;
+            c.pipelines.push_back(Pipeline(length, diameter, material, flow, pressure, status, schedule, cost, leak));
+        }
+        uint8_t disconnected = 0;
+        if (in < end && !getRaw(in, end, disconnected))
+            return false;
+        c.disconnected = disconnected != 0;
+        if (c.disconnected && (!getString(in, end, c.disconnect_reason) || !getRaw(in, end, c.disconnected_at)))
+            return false;
+        return true;
+    }
+
+    template <typename T>
+    static void putRaw(string& out, T value) {
+        out.append((const char*)&value, sizeof(T));
+    }
+
+    template <typename T>
+    static bool getRaw(const char*& in, const char* end, T& value) {
+        if ((size_t)(end - in) < sizeof(T))
+            return false;
+        memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+        return true;
+    }
+
+    static void putString(string& out, const string& s) {
+        putRaw(out, (uint32_t)s.size());
+        out.append(s);
+    }
+
+    static bool getString(const char*& in, const char* end, string& s) {
+        uint32_t length;
+        if (!getRaw(in, end, length) || (size_t)(end - in) < length)
+            return false;
+        s.assign(in, length);
+        in += length;
+        return true;
+    }
+};
+
+// Class to make a CustomerStore durable with a write-ahead log and compacted snapshots.
+// Files: <path>.wal holds mutations since the last snapshot, <path>.snapshot every customer
+// (disconnected ones included until they are compacted).
+// Each record is [length][checksum][type][payload]; a torn record at the end of the log is dropped
+// on recovery. Writers append to a shared buffer and one of them writes and syncs it for everybody
+// (group commit), so concurrent writers share each fsync.
+class DurableCustomerStore {
+public:
+    ~DurableCustomerStore() {
+        close();
+    }
+
+    // Load the snapshot and replay the log; creates the files if they do not exist
+    bool open(const string& path) {
+        close();
+        basePath = path;
+        CustomerStore recovered;
+        generation = 0;
+        replayed = 0;
+
+        FILE* snapshot = fopen((path + ".snapshot").c_str(), "rb");
+        if (snapshot) {
+            bool ok = loadSnapshot(snapshot, recovered);
+            fclose(snapshot);
+            if (!ok) {
+                cout << "Customer snapshot " << path << ".snapshot is damaged." << endl;
+                return false;
+            }
+        }
+
+        long validBytes = 0;
+        FILE* log = fopen((path + ".wal").c_str(), "rb");
+        if (log) {
+            validBytes = replayLog(log, recovered);
+            fclose(log);
+        }
+        if (validBytes == 0) {
+            if (!startLog())
+                return false;
+        } else {
+            if (!truncateFile(path + ".wal", validBytes))
+                return false;
+            wal = fopen((path + ".wal").c_str(), "ab");
+            if (!wal) {
+                cout << "Unable to open " << path << ".wal for writing." << endl;
+                return false;
+            }
+            walBytes = (uint64_t)validBytes;
+        }
+        store = move(recovered);
+        return true;
+    }
+
+    void close() {
+        stopCompactor();
+        if (!wal)
+            return;
+        flush();
+        fclose(wal);
+        wal = NULL;
+    }
+
+    bool put(const Customer& c) {
+        string record;
+        CustomerCodec::putCustomer(record, c);
+        uint64_t lsn;
+        {
+            lock_guard<mutex> lock(stateLock);
+            store.insert(c);
+            lsn = appendRecord(PUT, record);
+        }
+        return waitDurable(lsn);
+    }
+
+    // Many customers in one log write and one sync
+    bool putBatch(const vector<Customer>& batch) {
+        uint64_t lsn = 0;
+        string record;
+        {
+            lock_guard<mutex> lock(stateLock);
+            for (const Customer& c : batch) {
+                record.clear();
+                CustomerCodec::putCustomer(record, c);
+                store.insert(c);
+                lsn = appendRecord(PUT, record);
+            }
+        }
+        return batch.empty() || waitDurable(lsn);
+    }
+
+    // Add only customers whose IDs are not in the store yet (disconnected ones count as present),
+    // in one bulk load, one log write and one sync. The IDs left alone are added to existing.
+    // The batch is consumed.
+    bool insertNew(vector<Customer>& batch, vector<string>& existing) {
+        uint64_t lsn = 0;
+        {
+            lock_guard<mutex> lock(stateLock);
+            size_t kept = 0;
+            for (size_t i = 0; i < batch.size(); ++i) {
+                if (store.find(batch[i].customer_id)) {
+                    existing.push_back(batch[i].customer_id);
+                    continue;
+                }
+                if (kept != i)
+                    batch[kept] = move(batch[i]);
+                kept++;
+            }
+            batch.resize(kept);
+            string record;
+            for (const Customer& c : batch) {
+                record.clear();
+                CustomerCodec::putCustomer(record, c);
+                lsn = appendRecord(PUT, record);
+            }
+            store.bulkLoad(batch);
+        }
+        return lsn == 0 || waitDurable(lsn);
+    }
+
+    bool erase(const string& id) {
+        uint64_t lsn;
+        {
+            lock_guard<mutex> lock(stateLock);
+            if (!store.erase(id))
+                return false;
+            string record;
+            CustomerCodec::putString(record, id);
+            lsn = appendRecord(ERASE, record);
+        }
+        return waitDurable(lsn);
+    }
+
+    // Tombstone the customer (see CustomerStore::disconnect) and log it
+    bool disconnect(const string& id, const string& reason, int64_t timestamp) {
+        uint64_t lsn;
+        {
+            lock_guard<mutex> lock(stateLock);
+            if (!store.disconnect(id, reason, timestamp))
+                return false;
+            string record;
+            CustomerCodec::putString(record, id);
+            CustomerCodec::putString(record, reason);
+            CustomerCodec::putRaw(record, timestamp);
+            lsn = appendRecord(DISCONNECT, record);
+        }
+        return waitDurable(lsn);
+    }
+
+    // Erase one batch of customers disconnected at or before cutoff; returns how many
+    size_t compact(int64_t cutoff, size_t batch) {
+        vector<string> erased;
+        uint64_t lsn = 0;
+        {
+            lock_guard<mutex> lock(stateLock);
+            store.compactTombstones(batch, cutoff, erased);
+            string record;
+            for (const string& id : erased) {
+                record.clear();
+                CustomerCodec::putString(record, id);
+                lsn = appendRecord(ERASE, record);
+            }
+        }
+        if (!erased.empty())
+            waitDurable(lsn);
+        return erased.size();
+    }
+
+    // Compact, in the background, customers disconnected longer than retentionSeconds ago.
+    // The store lock is only held for one batch at a time, so foreground requests keep going.
+    void startCompactor(int64_t retentionSeconds, size_t batch = 1000, chrono::milliseconds interval = chrono::milliseconds(200)) {
+        stopCompactor();
+        compactorStopping = false;
+        compactor = thread([this, retentionSeconds, batch, interval]() {
+            unique_lock<mutex> lock(compactorLock);
+            while (!compactorStopping) {
+                lock.unlock();
+                size_t done = compact((int64_t)time(NULL) - retentionSeconds, batch);
+                lock.lock();
+                if (done < batch)
+                    compactorWake.wait_for(lock, interval, [this]() { return compactorStopping; });
+            }
+        });
+    }
+
+    void stopCompactor() {
+        if (!compactor.joinable())
+            return;
+        {
+            lock_guard<mutex> lock(compactorLock);
+            compactorStopping = true;
+        }
+        compactorWake.notify_all();
+        compactor.join();
+    }
+
+    // Write every customer to a new snapshot and start an empty log
+    bool snapshot() {
+        unique_lock<mutex> lock(stateLock);
+        while (flushing)
+            flushed.wait(lock);
+        if (!wal || !writePending())
+            return false;
+
+        string tmpPath = basePath + ".snapshot.tmp";
+        FILE* out = fopen(tmpPath.c_str(), "wb");
+        if (!out) {
+            cout << "Unable to write " << tmpPath << "." << endl;
+            return false;
+        }
+        setvbuf(out, NULL, _IOFBF, 1 << 20);
+        string header = "CSNP";
+        CustomerCodec::putRaw(header, generation + 1);
+        CustomerCodec::putRaw(header, (uint64_t)store.size());
+        bool ok = fwrite(header.data(), 1, header.size(), out) == header.size();
+        string record;
+        for (const Customer& c : store) {
+            record.clear();
+            CustomerCodec::putCustomer(record, c);
+            ok = ok && writeRecord(out, PUT, record);
+        }
+        ok = ok && syncFile(out);
+        fclose(out);
+        if (!ok || !replaceFile(tmpPath, basePath + ".snapshot")) {
+            cout << "Unable to write the customer snapshot." << endl;
+            remove(tmpPath.c_str());
+            return false;
+        }
+
+        // The snapshot now covers the old log; a log of an older generation is ignored on recovery
+        generation++;
+        fclose(wal);
+        wal = NULL;
+        return startLog();
+    }
+
+    // Hold the returned lock while reading customers() once the compactor is running
+    const CustomerStore& customers() const {
+        return store;
+    }
+
+    unique_lock<mutex> lockForReading() {
+        return unique_lock<mutex>(stateLock);
+    }
+
+    size_t size() const {
+        return store.size();
+    }
+
+    // Log records replayed by the last open()
+    uint64_t replayedRecords() const {
+        return replayed;
+    }
+
+    uint64_t logSyncs() const {
+        return syncs;
+    }
+
+    // A snapshot is taken automatically once the log grows past this many bytes
+    void setSnapshotThreshold(uint64_t bytes) {
+        snapshotThreshold = bytes;
+    }
+
+private:
+    enum RecordType : uint8_t { PUT = 1, ERASE = 2, DISCONNECT = 3 };
+
+    CustomerStore store;
+    string basePath;
+    FILE* wal = NULL;
+    uint32_t generation = 0;
+    uint64_t walBytes = 0;
+    uint64_t snapshotThreshold = 256ULL << 20;
+    uint64_t replayed = 0;
+    uint64_t syncs = 0;
+
+    mutex stateLock;
+    condition_variable flushed;
+    string pending;               // records appended but not yet written
+    uint64_t appendedLsn = 0;
+    uint64_t durableLsn = 0;
+    bool flushing = false;
+    bool failed = false;
+
+    thread compactor;
+    mutex compactorLock;
+    condition_variable compactorWake;
+    bool compactorStopping = false;
+
+    static void frame(string& out, RecordType type, const string& payload) {
+        string body(1, (char)type);
+        body += payload;
+        CustomerCodec::putRaw(out, (uint32_t)body.size());
+        CustomerCodec::putRaw(out, recordChecksum(body.data(), body.size()));
+        out += body;
+    }
+
+    static bool writeRecord(FILE* out, RecordType type, const string& payload) {
+        string framed;
+        frame(framed, type, payload);
+        return fwrite(framed.data(), 1, framed.size(), out) == framed.size();
+    }
+
+    // Read the next record; false at the end of the file or at a torn / corrupt record
+    static bool readRecord(FILE* in, RecordType& type, string& payload) {
+        uint32_t length, checksum;
+        if (fread(&length, sizeof(length), 1, in) != 1 || fread(&checksum, sizeof(checksum), 1, in) != 1
+            || length == 0 || length > (64u << 20))
+            return false;
+        payload.resize(length);
+        if (fread(&payload[0], 1, length, in) != length || recordChecksum(payload.data(), length) != checksum)
+            return false;
+        type = (RecordType)payload[0];
+        return true;
+    }
+
+    static bool syncFile(FILE* f) {
+        if (fflush(f) != 0)
+            return false;
+#ifndef _WIN32
+        return fsync(fileno(f)) == 0;
+#else
+        return true;
+#endif
+    }
+
+    static bool replaceFile(const string& from, const string& to) {
+#ifdef _WIN32
+        remove(to.c_str());
+#endif
+        return rename(from.c_str(), to.c_str()) == 0;
+    }
+
+    static bool truncateFile(const string& path, long bytes) {
+#ifndef _WIN32
+        if (truncate(path.c_str(), bytes) == 0)
+            return true;
+#endif
+        cout << "Unable to drop the torn tail of " << path << "." << endl;
+        return false;
+    }
+
+    bool loadSnapshot(FILE* in, CustomerStore& into) {
+        setvbuf(in, NULL, _IOFBF, 1 << 20);
+        char magic[4];
+        uint64_t count;
+        if (fread(magic, 1, 4, in) != 4 || memcmp(magic, "CSNP", 4) != 0
+            || fread(&generation, sizeof(generation), 1, in) != 1 || fread(&count, sizeof(count), 1, in) != 1)
+            return false;
+        // The count is not covered by any checksum: a damaged one must not size the reservation.
+        // Every record takes at least its length, checksum and type bytes.
+        long start = ftell(in);
+        if (start < 0 || fseek(in, 0, SEEK_END) != 0)
+            return false;
+        long end = ftell(in);
+        if (end < start || fseek(in, start, SEEK_SET) != 0)
+            return false;
+        const uint64_t minRecordBytes = 2 * sizeof(uint32_t) + 1;
+        if (count > (uint64_t)(end - start) / minRecordBytes)
+            return false;
+        vector<Customer> batch;
+        batch.reserve((size_t)count);
+        RecordType type;
+        string payload;
+        for (uint64_t i = 0; i < count; ++i) {
+            if (!readRecord(in, type, payload) || type != PUT)
+                return false;
+            const char* at = payload.data() + 1;
+            batch.emplace_back();
+            if (!CustomerCodec::getCustomer(at, payload.data() + payload.size(), batch.back()))
+                return false;
+        }
+        into.bulkLoad(batch);
+        return true;
+    }
+
+    // Apply the log to the store; returns the length of its valid prefix (0 if it has to be restarted)
+    long replayLog(FILE* in, CustomerStore& into) {
+        setvbuf(in, NULL, _IOFBF, 1 << 20);
+        char magic[4];
+        uint32_t logGeneration;
+        if (fread(magic, 1, 4, in) != 4 || memcmp(magic, "CWAL", 4) != 0
+            || fread(&logGeneration, sizeof(logGeneration), 1, in) != 1 || logGeneration != generation)
+            return 0;
+        long valid = ftell(in);
+        RecordType type;
+        string payload;
+        while (readRecord(in, type, payload)) {
+            const char* at = payload.data() + 1;
+            const char* end = payload.data() + payload.size();
+            if (type == PUT) {
+                Customer c;
+                if (!CustomerCodec::getCustomer(at, end, c))
+                    break;
+                into.insert(c);
+            } else if (type == ERASE) {
+                string id;
+                if (!CustomerCodec::getString(at, end, id))
+                    break;
+                into.erase(id);
+            } else if (type == DISCONNECT) {
+                string id, reason;
+                int64_t timestamp;
+                if (!CustomerCodec::getString(at, end, id) || !CustomerCodec::getString(at, end, reason)
+                    || !CustomerCodec::getRaw(at, end, timestamp))
+                    break;
+                into.disconnect(id, reason, timestamp);
+            } else {
+                break;
+            }
+            replayed++;
+            valid = ftell(in);
+        }
+        return valid;
+    }
+
+    bool startLog() {
+        string tmpPath = basePath + ".wal.tmp";
+        FILE* out = fopen(tmpPath.c_str(), "wb");
+        bool ok = out != NULL;
+        if (ok) {
+            ok = fwrite("CWAL", 1, 4, out) == 4 && fwrite(&generation, sizeof(generation), 1, out) == 1 && syncFile(out);
+            fclose(out);
+        }
+        if (!ok || !replaceFile(tmpPath, basePath + ".wal")) {
+            cout << "Unable to create " << basePath << ".wal." << endl;
+            return false;
+        }
+        wal = fopen((basePath + ".wal").c_str(), "ab");
+        walBytes = 8;
+        return wal != NULL;
+    }
+
+    // Called with stateLock held
+    uint64_t appendRecord(RecordType type, const string& payload) {
+        frame(pending, type, payload);
+        return ++appendedLsn;
+    }
+
+    // Called with stateLock held and no flush in progress
+    bool writePending() {
+        if (pending.empty())
+            return !failed;
+        bool ok = fwrite(pending.data(), 1, pending.size(), wal) == pending.size() && syncFile(wal);
+        walBytes += pending.size();
+        pending.clear();
+        durableLsn = appendedLsn;
+        syncs++;
+        failed = failed || !ok;
+        return ok;
+    }
+
+    // Wait until the log holds record lsn; the first waiter writes everything pending for the others
+    bool waitDurable(uint64_t lsn) {
+        unique_lock<mutex> lock(stateLock);
+        while (durableLsn < lsn && !failed) {
+            if (flushing) {
+                flushed.wait(lock);
+                continue;
+            }
+            flushing = true;
+            string batch;
+            batch.swap(pending);
+            uint64_t upto = appendedLsn;
+            lock.unlock();
+            bool ok = wal && fwrite(batch.data(), 1, batch.size(), wal) == batch.size() && syncFile(wal);
+            lock.lock();
+            flushing = false;
+            syncs++;
+            walBytes += batch.size();
+            durableLsn = upto;
+            failed = failed || !ok;
+            flushed.notify_all();
+        }
+        if (failed) {
+            cout << "Writing the customer log failed; changes since the last sync may be lost." << endl;
+            return false;
+        }
+        bool compact = walBytes > snapshotThreshold;
+        lock.unlock();
+        if (compact)
+            snapshot();
+        return true;
+    }
+
+    void flush() {
+        unique_lock<mutex> lock(stateLock);
+        while (flushing)
+            flushed.wait(lock);
+        writePending();
+    }
+};
+
+class Graph : public BasicGraph<int, string>
+
+{
+public:
+
+    int getShortestDistanceToPumpStation(string customerLocation)
+    {
+        return nearestOtherNodeDistance(customerLocation);
+    }
+
+
+};
+
+void displayMenu()
+
+{
+    cout << "\n\nWelcome to the Belagavi City Water Corporation\n";
+    cout << "Please choose an option:\n";
+    cout << "0. Create New Customer\n";
+    cout << "1. Choose Material Type of Pipe\n";
+    cout << "2. Choose Billing Type\n";
+    cout << "3. Choose Leak Detection Type\n";
+    cout << "4. Choose Supply Type\n";
+    cout << "5. View Pipeline Details\n";
+    cout << "6. View Customer Details\n";
+    cout << "7. Finalize Selections\n";
+    cout << "8. View Total Installation Cost\n";
+    cout << "9. Update Maintenance Schedule\n";
+    cout << "10. Add New Pipeline\n";
+    cout << "11. Customer Details (Already Installed Pipeline)\n";
+    cout << "12. Disconnect Pipeline (Already Installed Pipeline)\n";
+    cout << "13. Exit\n";
+    cout << "14. Performance Benchmarks\n";
+    cout << "15. Customer Report (Location / Supply Type / Billing Cycle)\n";
+    cout << "16. Import Customers (CSV File)\n";
+    cout << "17. Query Customers (Filter Expression)\n";
+    cout << "18. Run Billing (All Customers)\n";
+    cout << "19. Reload Supply Tariff (File)\n";
+    cout << "20. Combined Utility Bill (Water, Electricity, Gas, Wi-Fi)\n";
+    cout << "21. Distance Between Two Areas (Sharded Router)\n";
+
+
+}
+
+// Structure to represent the AreaDetails with distance and cost
+struct AreaDetails {
+    string area_name;
+    int distance; // distance from selected area (in meters)
+    int cost;     // cost in Rs
+};
+
+// Structure to represent the Sub-division gas pipeline Office
+struct Sub_division_gas_pipeline_office {
+    vector<AreaDetails> areas;  // List of areas in the sub-division
+};
+
+// Function to implement the functionality of displaying areas based on the selected zone
+void displayAreas(const string& selected_zone, const unordered_map<string, vector<string>>& zone_areas)
+{
+    cout << selected_zone << " contains the following areas:\n";
+    const vector<string>& areas = zone_areas.at(selected_zone);  // Get areas for selected zone
+    for (size_t i = 0; i < areas.size(); ++i) {
+        cout << i + 1 << ". " << areas[i] << endl;  // Display area number and name
+    }
+}
+
+// Function to display the sub-division office and area details based on the selected area
+void displaySubDivisionDetails(const string& selected_area, const unordered_map<string, Sub_division_gas_pipeline_office>& area_details) {
+    auto it = area_details.find(selected_area);  // Find the selected area in the area details map
+    if (it != area_details.end()) {
+        // Correctly displaying the area name dynamically
+        cout << "gas pipeline office " << selected_area << ":\n";
+        for (size_t i = 0; i < it->second.areas.size(); ++i) {
+            const AreaDetails& area = it->second.areas[i];
+            cout << i + 1 << ". " << area.area_name << " - " << area.distance << " meters, cost - " << area.cost << " rs\n";
+        }
+    } else {
+        cout << "Area not found in this sub-division.\n";
+    }
+}
+
+// Function to find the area with the shortest distance
+string findShortestDistanceArea(const vector<AreaDetails>& areas) {
+    // Find the area with the minimum distance
+    auto min_it = min_element(areas.begin(), areas.end(), [](const AreaDetails& a, const AreaDetails& b) {
+        return a.distance < b.distance;
+    });
+    return min_it->area_name;
+}
+
+// Function to calculate the volume of a cylindrical pipe
+double calculatePipeVolume(double length, double outerDiameter, double thickness)
+{
+    const double PI = 3.14159265359;
+    double innerDiameter = outerDiameter - 2 * thickness;
+    double outerRadius = outerDiameter / 2.0;
+    double innerRadius = innerDiameter / 2.0;
+
+    double outerVolume = PI * outerRadius * outerRadius * length;
+    double innerVolume = PI * innerRadius * innerRadius * length;
+
+    return outerVolume - innerVolume; // Material volume
+}
+// Function to calculate the surface area of a cylindrical pipe
+double calculateSurfaceArea(double length, double outerDiameter)
+{
+    const double PI = 3.14159265359;
+    double radius = outerDiameter / 2.0;
+    return 2 * PI * radius * length; // Surface area of the cylindrical surface
+}
+
+// Function to categorize pressure
+string categorizePressure(double pressure)
+ {
+    if (pressure > 100)
+    {
+        return "High Pressure";
+    } else if (pressure >= 40 && pressure <= 100)
+    {
+        return "Medium Pressure";
+    } else
+    {
+        return "Low Pressure";
+    }
+}
+
+// Structure to report the outcome of a bulk customer import
+struct ImportReport {
+    size_t rows = 0;
+    size_t imported = 0;
+    size_t rejected = 0;
+    size_t unreachable = 0;      // imported, but no route to a pump station
+    size_t duplicates = 0;       // rejected: ID repeated in the file or already a customer
+    vector<string> errors;       // first rejected rows, as "line N: reason"
+    double milliseconds = 0;
+};
+
+// Class to bulk-import customers from a CSV file with the columns
+//   name,address,customer_id,location,supply_type,billing_cycle,total_usage,total_amount
+// The file is memory-mapped and split at line boundaries across threads. Fields may be quoted as in
+// RFC 4180 ("12, Elm St"), but a row must fit on one line. Fields are validated as views into the
+// mapping, and every customer gets a pipeline as long as the route to the nearest pump station that
+// the RouteCostEngine quotes installations along (looked up once per location, after parsing). Only
+// new customers are added: a repeated ID in the file, or one already in the store, rejects the row.
+template <typename RouteEngine>
+class CustomerCsvImporter {
+public:
+    static const size_t MAX_ERRORS = 20;
+
+    CustomerCsvImporter(RouteEngine& engine) : routes(engine) {}
+
+    // threads = 0 uses every hardware thread
+    ImportReport import(const string& path, DurableCustomerStore& store, int threads = 0) {
+        ImportReport report;
+        auto start = chrono::steady_clock::now();
+        MappedFile file;
+        if (!file.open(path)) {
+            report.errors.push_back("Unable to read " + path);
+            return report;
+        }
+
+        if (threads <= 0)
+            threads = max(1u, thread::hardware_concurrency());
+        if (file.size < (1 << 20))
+            threads = 1;
+        vector<Chunk> chunks(threads);
+        size_t begin = 0;
+        for (int t = 0; t < threads; ++t) {
+            size_t end = t == threads - 1 ? file.size : max(begin, file.size / threads * (t + 1));
+            while (end < file.size && file.data[end - 1] != '\n')
+                ++end;
+            chunks[t].begin = begin;
+            chunks[t].end = end;
+            begin = end;
+        }
+
+        vector<thread> workers;
+        for (int t = 1; t < threads; ++t)
+            workers.push_back(thread([this, &file, &chunks, t]() { parse(file.data, chunks[t], false); }));
+        parse(file.data, chunks[0], true);
+        for (thread& worker : workers)
+            worker.join();
+
+        vector<Customer> customers;
+        customers.reserve(file.size / 64);
+        unordered_map<string, pair<size_t, bool>> seen;     // ID -> file line, whether it has a route
+        seen.reserve(file.size / 64);
+        unordered_map<string, int> distances;               // location -> meters to the nearest pump station
+        size_t linesBefore = 0;
+        for (Chunk& chunk : chunks) {
+            report.rows += chunk.rows;
+            report.rejected += chunk.rejected;
+            for (const auto& error : chunk.errors)
+                addError(report, linesBefore + error.first, error.second);
+            for (size_t i = 0; i < chunk.customers.size(); ++i) {
+                Customer& c = chunk.customers[i];
+                size_t line = linesBefore + chunk.customerLines[i];
+                auto first = seen.emplace(c.customer_id, make_pair(line, false));
+                if (!first.second) {
+                    report.rejected++;
+                    report.duplicates++;
+                    addError(report, line, "customer ID " + c.customer_id + " already on line "
+                                               + to_string(first.first->second.first));
+                    continue;
+                }
+                auto known = distances.find(c.location);
+                if (known == distances.end())
+                    known = distances.emplace(c.location, routes.nearestStationMeters(c.location)).first;
+                if (known->second >= 0) {
+                    c.pipelines.push_back(Pipeline(known->second, 12, "Steel", 20.5, 250, "Active", "Monthly", 0.0, ""));
+                    first.first->second.second = true;
+                } else {
+                    report.unreachable++;
+                }
+                customers.push_back(move(c));
+            }
+            linesBefore += chunk.lines;
+            chunk.customers.clear();
+        }
+
+        report.imported = customers.size();
+        vector<string> existing;
+        bool saved = customers.empty() || store.insertNew(customers, existing);
+        for (const string& id : existing) {
+            const pair<size_t, bool>& row = seen[id];
+            report.imported--;
+            report.rejected++;
+            report.duplicates++;
+            if (!row.second)
+                report.unreachable--;
+            addError(report, row.first, "customer ID " + id + " already exists");
+        }
+        if (!saved) {
+            // Reported first, since the error list may already be full
+            report.errors.insert(report.errors.begin(), "Writing the customer log failed; the " + to_string(report.imported)
+                                                            + " new customer(s) were not saved");
+            report.rejected += report.imported;
+            report.imported = 0;
+            report.unreachable = 0;
+        }
+        report.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        return report;
+    }
+
+private:
+    RouteEngine& routes;
+
+    // Structure to represent the part of the file one thread parses, and what it found there
+    struct Chunk {
+        size_t begin = 0, end = 0;
+        size_t lines = 0, rows = 0, rejected = 0;
+        vector<Customer> customers;
+        vector<size_t> customerLines;            // line of each customer within the chunk (1-based)
+        vector<pair<size_t, string>> errors;     // line within the chunk (1-based), reason
+    };
+
+    static void addError(ImportReport& report, size_t line, const string& reason) {
+        if (report.errors.size() < MAX_ERRORS)
+            report.errors.push_back("line " + to_string(line) + ": " + reason);
+    }
+
+    // Structure to map a whole file read-only (read into memory where mmap is unavailable)
+    struct MappedFile {
+        const char* data = NULL;
+        size_t size = 0;
+#ifndef _WIN32
+        void* mapping = NULL;
+
+        bool open(const string& path) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return false;
+            struct stat info;
+            bool ok = fstat(fd, &info) == 0;
+            size = ok ? (size_t)info.st_size : 0;
+            if (ok && size > 0) {
+                mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                ok = mapping != MAP_FAILED;
+                if (ok) {
+                    madvise(mapping, size, MADV_SEQUENTIAL);
+                    data = (const char*)mapping;
+                } else {
+                    mapping = NULL;
+                }
+            }
+            ::close(fd);
+            return ok;
+        }
+
+        ~MappedFile() {
+            if (mapping)
+                munmap(mapping, size);
+        }
+#else
+        string contents;
+
+        bool open(const string& path) {
+            FILE* in = fopen(path.c_str(), "rb");
+            if (!in)
+                return false;
+            char buffer[1 << 16];
+            size_t n;
+            while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+                contents.append(buffer, n);
+            fclose(in);
+            data = contents.data();
+            size = contents.size();
+            return true;
+        }
+#endif
+    };
+
+    static bool isOneOf(string_view value, const char* const* names, size_t count) {
+        for (size_t i = 0; i < count; ++i)
+            if (value == names[i])
+                return true;
+        return false;
+    }
+
+    static bool parseAmount(string_view field, double& value) {
+        const char* end = field.data() + field.size();
+        from_chars_result result = from_chars(field.data(), end, value);
+        return !field.empty() && result.ec == errc() && result.ptr == end && value >= 0;
+    }
+
+    // Why the row is invalid, or NULL if it is fine
+    static const char* validate(const string_view* fields, double& usage, double& amount) {
+        if (fields[0].empty())
+            return "missing name";
+        if (fields[2].empty())
+            return "missing customer ID";
+        for (char c : fields[2])
+            if (!isalnum((unsigned char)c))
+                return "customer ID must be letters and digits";
+        if (fields[3].empty())
+            return "missing location";
+        if (!isOneOf(fields[4], SupplyTypeValues::names, size(SupplyTypeValues::names)))
+            return "unknown supply type";
+        if (!isOneOf(fields[5], BillingCycleValues::names, size(BillingCycleValues::names)))
+            return "unknown billing cycle";
+        if (!parseAmount(fields[6], usage))
+            return "total usage is not a non-negative number";
+        if (!parseAmount(fields[7], amount))
+            return "total amount is not a non-negative number";
+        return NULL;
+    }
+
+    // Split a line into fields, RFC 4180 style: a field may be quoted to hold commas, with "" for a
+    // quote inside it (unescaped into scratch). Returns the field count (9 when there are more than
+    // 8), or 0 for a malformed quoted field or a quote inside an unquoted one.
+    static size_t splitFields(string_view line, string_view* fields, string* scratch) {
+        size_t count = 0, at = 0;
+        while (true) {
+            if (count == 8)
+                return 9;
+            if (at < line.size() && line[at] == '"') {
+                size_t start = ++at;
+                bool escaped = false;
+                size_t quote;
+                while (true) {
+                    quote = line.find('"', at);
+                    if (quote == string_view::npos)
+                        return 0;
+                    if (quote + 1 < line.size() && line[quote + 1] == '"') {
+                        escaped = true;
+                        at = quote + 2;
+                        continue;
+                    }
+                    break;
+                }
+                string_view raw = line.substr(start, quote - start);
+                if (escaped) {
+                    scratch[count].clear();
+                    for (size_t i = 0; i < raw.size(); ++i) {
+                        scratch[count] += raw[i];
+                        if (raw[i] == '"')
+                            ++i;
+                    }
+                    raw = scratch[count];
+                }
+                fields[count++] = raw;
+                at = quote + 1;
+                if (at == line.size())
+                    return count;
+                if (line[at] != ',')
+                    return 0;
+                ++at;
+            } else {
+                size_t comma = line.find(',', at);
+                string_view field = line.substr(at, comma == string_view::npos ? string_view::npos : comma - at);
+                if (field.find('"') != string_view::npos)
+                    return 0;
+                fields[count++] = field;
+                if (comma == string_view::npos)
+                    return count;
+                at = comma + 1;
+            }
+        }
+    }
+
+    void parse(const char* data, Chunk& chunk, bool first) const {
+        string_view fields[8];
+        string scratch[8];
+        const char* at = data + chunk.begin;
+        const char* end = data + chunk.end;
+        while (at < end) {
+            const char* newline = (const char*)memchr(at, '\n', end - at);
+            const char* lineEnd = newline ? newline : end;
+            string_view line(at, lineEnd - at);
+            at = newline ? newline + 1 : end;
+            chunk.lines++;
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            if (line.empty())
+                continue;
+            if (first && chunk.lines == 1 && line.substr(0, 5) == "name,")
+                continue;   // header row
+
+            chunk.rows++;
+            size_t count = splitFields(line, fields, scratch);
+            double usage = 0, amount = 0;
+            const char* problem = count == 0 ? "malformed quoted field"
+                                : count != 8 ? "expected 8 comma-separated fields" : validate(fields, usage, amount);
+            if (problem) {
+                chunk.rejected++;
+                if (chunk.errors.size() < MAX_ERRORS)
+                    chunk.errors.push_back(make_pair(chunk.lines, string(problem)));
+                continue;
+            }
+
+            chunk.customers.push_back(Customer(string(fields[0]), string(fields[1]), string(fields[2]), string(fields[3]),
+                                               string(fields[4]), string(fields[5]), usage, amount));
+            chunk.customerLines.push_back(chunk.lines);
+        }
+    }
+};
+
+// Distance used for "no path" in the all-pairs matrix; INF + INF still fits in int32
+const int32_t DISTANCE_INF = 0x3f3f3f3f;
+
+// Tile size of the blocked Floyd-Warshall (64 x 64 int32 = 16 KB, three tiles fit in L1/L2)
+const int DISTANCE_BLOCK = 64;
+
+// Structure to represent the all-pairs distance matrix of a set of areas
+struct DistanceMatrix {
+    vector<string> nodes;   // area name of each row / column
+    int size = 0;           // number of real areas
+    int stride = 0;         // padded row length, multiple of DISTANCE_BLOCK
+    vector<int32_t> dist;   // row-major, dist[i * stride + j]
+
+    int32_t at(int i, int j) const {
+        return dist[(size_t)i * stride + j];
+    }
+};
+
+// Function to relax one tile: C[i][j] = min(C[i][j], A[i][k] + B[k][j]) for k in the tile.
+// k is the outer loop so the same kernel is correct when C aliases A or B (diagonal tiles).
+void minPlusTile(int32_t* C, const int32_t* A, const int32_t* B, int stride)
+{
+    for (int k = 0; k < DISTANCE_BLOCK; ++k) {
+        const int32_t* bRow = B + (size_t)k * stride;
+        for (int i = 0; i < DISTANCE_BLOCK; ++i) {
+            int32_t aik = A[(size_t)i * stride + k];
+            if (aik >= DISTANCE_INF)
+                continue;
+            int32_t* cRow = C + (size_t)i * stride;
+            int j = 0;
+#ifdef __AVX2__
+            __m256i a = _mm256_set1_epi32(aik);
+            for (; j < DISTANCE_BLOCK; j += 8) {
+                __m256i b = _mm256_loadu_si256((const __m256i*)(bRow + j));
+                __m256i c = _mm256_loadu_si256((const __m256i*)(cRow + j));
+                _mm256_storeu_si256((__m256i*)(cRow + j), _mm256_min_epi32(c, _mm256_add_epi32(a, b)));
+            }
+#endif
+            for (; j < DISTANCE_BLOCK; ++j) {
+                int32_t through = aik + bRow[j];
+                cRow[j] = through < cRow[j] ? through : cRow[j];
+            }
+        }
+    }
+}
+
+// Function to run the three-phase cache-blocked Floyd-Warshall on a padded matrix
+void floydWarshallBlocked(int32_t* d, int stride)
+{
+    int blocks = stride / DISTANCE_BLOCK;
+    auto tile = [&](int bi, int bj) {
+        return d + (size_t)bi * DISTANCE_BLOCK * stride + (size_t)bj * DISTANCE_BLOCK;
+    };
+
+    for (int kb = 0; kb < blocks; ++kb) {
+        int32_t* pivot = tile(kb, kb);
+        minPlusTile(pivot, pivot, pivot, stride);
+
+        for (int b = 0; b < blocks; ++b) {
+            if (b == kb)
+                continue;
+            minPlusTile(tile(kb, b), pivot, tile(kb, b), stride);  // pivot row
+            minPlusTile(tile(b, kb), tile(b, kb), pivot, stride);  // pivot column
+        }
+
+        for (int bi = 0; bi < blocks; ++bi) {
+            if (bi == kb)
+                continue;
+            for (int bj = 0; bj < blocks; ++bj) {
+                if (bj == kb)
+                    continue;
+                minPlusTile(tile(bi, bj), tile(bi, kb), tile(kb, bj), stride);
+            }
+        }
+    }
+}
+
+// Function to fill every row of the matrix with one Dijkstra per source (sparse networks)
+void repeatedDijkstra(DistanceMatrix& m, const vector<vector<pair<int, int32_t>>>& adj)
+{
+    typedef pair<int32_t, int> QueueEntry;
+    for (int s = 0; s < m.size; ++s) {
+        int32_t* row = &m.dist[(size_t)s * m.stride];
+        row[s] = 0;
+        priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry>> pq;
+        pq.push(make_pair(0, s));
+        while (!pq.empty()) {
+            int32_t du = pq.top().first;
+            int u = pq.top().second;
+            pq.pop();
+            if (du > row[u])
+                continue;
+            for (const auto& e : adj[u]) {
+                if (du + e.second < row[e.first]) {
+                    row[e.first] = du + e.second;
+                    pq.push(make_pair(row[e.first], e.first));
+                }
+            }
+        }
+    }
+}
+
+// Function to compute all-pairs shortest distances for a small set of areas in one call.
+// edges are undirected (from, to, meters) with indices into nodes.
+DistanceMatrix computeAllPairsDistances(const vector<string>& nodes, const vector<tuple<int, int, int32_t>>& edges)
+{
+    DistanceMatrix m;
+    m.nodes = nodes;
+    m.size = (int)nodes.size();
+    m.stride = max(DISTANCE_BLOCK, (m.size + DISTANCE_BLOCK - 1) / DISTANCE_BLOCK * DISTANCE_BLOCK);
+    m.dist.assign((size_t)m.stride * m.stride, DISTANCE_INF);
+
+    // Floyd-Warshall costs ~n^3 / 8 vector ops, repeated Dijkstra ~n * m * log n scalar ops
+    double n = m.size;
+    double logN = n > 2 ? log2(n) : 1.0;
+    bool sparse = (double)edges.size() * 160.0 * logN < n * n;
+
+    if (sparse) {
+        vector<vector<pair<int, int32_t>>> adj(m.size);
+        for (const auto& e : edges) {
+            adj[get<0>(e)].push_back(make_pair(get<1>(e), get<2>(e)));
+            adj[get<1>(e)].push_back(make_pair(get<0>(e), get<2>(e)));
+        }
+        repeatedDijkstra(m, adj);
+        return m;
+    }
+
+    for (int i = 0; i < m.stride; ++i)
+        m.dist[(size_t)i * m.stride + i] = 0;
+    for (const auto& e : edges) {
+        int u = get<0>(e), v = get<1>(e);
+        int32_t w = get<2>(e);
+        if (u == v)
+            continue;
+        int32_t& uv = m.dist[(size_t)u * m.stride + v];
+        int32_t& vu = m.dist[(size_t)v * m.stride + u];
+        uv = min(uv, w);
+        vu = min(vu, w);
+    }
+    floydWarshallBlocked(m.dist.data(), m.stride);
+    return m;
+}
+
+// Function to build the all-pairs distance matrix of a sub-division office.
+// The office area is linked to each of its areas, and any network edges between those areas are added.
+DistanceMatrix computeSubDivisionDistanceMatrix(const string& office_area, const Sub_division_gas_pipeline_office& office, const Graph& g)
+{
+    vector<string> nodes;
+    map<string, int> index;
+    auto indexOf = [&](const string& name) {
+        auto it = index.find(name);
+        if (it != index.end())
+            return it->second;
+        index[name] = (int)nodes.size();
+        nodes.push_back(name);
+        return (int)nodes.size() - 1;
+    };
+
+    int hub = indexOf(office_area);
+    vector<tuple<int, int, int32_t>> edges;
+    for (const AreaDetails& area : office.areas) {
+        edges.push_back(make_tuple(hub, indexOf(area.area_name), (int32_t)area.distance));
+    }
+
+    for (const auto& entry : index) {
+        auto it = g.adj.find(entry.first);
+        if (it == g.adj.end())
+            continue;
+        for (const auto& neighbor : it->second) {
+            auto other = index.find(neighbor.first);
+            if (other != index.end() && entry.second < other->second) {
+                edges.push_back(make_tuple(entry.second, other->second, (int32_t)neighbor.second));
+            }
+        }
+    }
+    return computeAllPairsDistances(nodes, edges);
+}
+
+// Function to display the all-pairs distance matrix of a sub-division office
+void displayDistanceMatrix(const DistanceMatrix& m)
+{
+    cout << "\nDistances between areas of this office (meters):\n";
+    for (int i = 0; i < m.size; ++i) {
+        cout << i + 1 << ". " << m.nodes[i] << endl;
+    }
+    cout << "      ";
+    for (int j = 0; j < m.size; ++j) {
+        cout << "\t" << j + 1;
+    }
+    cout << "\n";
+    for (int i = 0; i < m.size; ++i) {
+        cout << i + 1 << ".";
+        for (int j = 0; j < m.size; ++j) {
+            cout << "\t";
+            if (m.at(i, j) >= DISTANCE_INF)
+                cout << "-";
+            else
+                cout << m.at(i, j);
+        }
+        cout << "\n";
+    }
+}
+
+// Function to benchmark the all-pairs distance matrix on random networks of 64 to 4096 areas
+void benchmarkDistanceMatrix()
+{
+    mt19937 rng(42);
+    uniform_int_distribution<int32_t> meters(100, 5000);
+
+    cout << "\nAll-pairs distance matrix benchmark (blocked Floyd-Warshall";
+#ifdef __AVX2__
+    cout << ", AVX2";
+#endif
+    cout << ")\n";
+    cout << "Areas\tBlocked (ms)\tNaive (ms)\n";
+
+    for (int n = 64; n <= 4096; n *= 2) {
+        vector<string> nodes(n);
+        vector<tuple<int, int, int32_t>> edges;
+        for (int i = 0; i < n; ++i) {
+            nodes[i] = "Area " + to_string(i + 1);
+            for (int e = 0; e < 16; ++e) {
+                edges.push_back(make_tuple(i, (int)(rng() % n), meters(rng)));
+            }
+        }
+
+        auto start = chrono::steady_clock::now();
+        DistanceMatrix m = computeAllPairsDistances(nodes, edges);
+        double blockedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        // Textbook triple loop on the same input, skipped for the largest sizes
+        cout << n << "\t" << blockedMs << "\t\t";
+        if (n <= 1024) {
+            vector<int32_t> d((size_t)n * n, DISTANCE_INF);
+            for (int i = 0; i < n; ++i)
+                d[(size_t)i * n + i] = 0;
+            for (const auto& e : edges) {
+                int u = get<0>(e), v = get<1>(e);
+                if (u == v)
+                    continue;
+                d[(size_t)u * n + v] = min(d[(size_t)u * n + v], get<2>(e));
+                d[(size_t)v * n + u] = min(d[(size_t)v * n + u], get<2>(e));
+            }
+            start = chrono::steady_clock::now();
+            for (int k = 0; k < n; ++k)
+                for (int i = 0; i < n; ++i)
+                    for (int j = 0; j < n; ++j)
+                        if (d[(size_t)i * n + k] + d[(size_t)k * n + j] < d[(size_t)i * n + j])
+                            d[(size_t)i * n + j] = d[(size_t)i * n + k] + d[(size_t)k * n + j];
+            double naiveMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+            bool same = true;
+            for (int i = 0; i < n && same; ++i)
+                for (int j = 0; j < n; ++j)
+                    if (m.at(i, j) != d[(size_t)i * n + j]) {
+                        same = false;
+                        break;
+                    }
+            cout << naiveMs << (same ? "" : "  (MISMATCH)");
+        } else {
+            cout << "-";
+        }
+        cout << endl;
+    }
+}
+
+// Structure to represent one level of the multilevel partitioner in compressed (CSR) form
+struct PartitionLevel {
+    vector<int> offsets;      // row offsets into targets / edgeWeights
+    vector<int> targets;      // neighbour node ids
+    vector<int> edgeWeights;  // number of network edges collapsed into this edge
+    vector<int> nodeWeights;  // number of network nodes collapsed into this node
+    vector<int> coarseOf;     // id of this node in the next coarser level
+
+    int nodeCount() const {
+        return (int)nodeWeights.size();
+    }
+};
+
+// Structure to represent the result of splitting the network into k shards
+struct PartitionResult {
+    int k = 0;
+    vector<int> part;         // shard of each node (indexed like GraphPartitioner::nodeNames)
+    vector<int> partWeight;   // number of nodes in each shard
+    long long edgeCut = 0;    // number of network edges between different shards
+};
+
+// Class to split the pump station network into k balanced shards with a small edge cut.
+// Multilevel scheme: heavy-edge matching to coarsen, greedy growing on the coarsest level,
+// then boundary refinement while projecting back to the original network.
+class GraphPartitioner {
+public:
+    vector<string> nodeNames;
+    map<string, int> nodeIds;
+    PartitionLevel base;
+
+    GraphPartitioner(const Graph& g) {
+        for (const auto& node : g.adj) {
+            nodeIds[node.first] = (int)nodeNames.size();
+            nodeNames.push_back(node.first);
+        }
+        base.offsets.push_back(0);
+        for (const auto& node : g.adj) {
+            for (const auto& neighbor : node.second) {
+                base.targets.push_back(nodeIds[neighbor.first]);
+                base.edgeWeights.push_back(1);
+            }
+            base.offsets.push_back((int)base.targets.size());
+        }
+        base.nodeWeights.assign(nodeNames.size(), 1);
+    }
+
+    PartitionResult partition(int k, double imbalance = 0.03) {
+        PartitionResult result;
+        result.k = k;
+        if (base.nodeCount() == 0 || k < 1)
+            return result;
+
+        mt19937 rng(12345);
+        vector<PartitionLevel> levels;
+        levels.push_back(base);
+        int stopAt = max(20 * k, 64);
+        while (levels.back().nodeCount() > stopAt) {
+            PartitionLevel coarse = coarsen(levels.back(), rng);
+            if (coarse.nodeCount() > levels.back().nodeCount() * 95 / 100)
+                break;
+            levels.push_back(coarse);
+        }
+
+        long long total = base.nodeCount();
+        int maxWeight = (int)ceil((1.0 + imbalance) * total / k);
+
+        vector<int> part = initialPartition(levels.back(), k);
+        refine(levels.back(), part, k, maxWeight);
+        for (int level = (int)levels.size() - 2; level >= 0; --level) {
+            vector<int> finer(levels[level].nodeCount());
+            for (int u = 0; u < levels[level].nodeCount(); ++u)
+                finer[u] = part[levels[level].coarseOf[u]];
+            part.swap(finer);
+            refine(levels[level], part, k, maxWeight);
+        }
+
+        result.part = part;
+        result.partWeight.assign(k, 0);
+        for (int u = 0; u < base.nodeCount(); ++u) {
+            result.partWeight[part[u]]++;
+            for (int e = base.offsets[u]; e < base.offsets[u + 1]; ++e)
+                if (part[base.targets[e]] != part[u])
+                    result.edgeCut++;
+        }
+        result.edgeCut /= 2;
+        return result;
+    }
 
-class Pipeline
+private:
+    // Match every node with its heaviest unmatched neighbour and merge the pairs
+    PartitionLevel coarsen(PartitionLevel& fine, mt19937& rng) {
+        int n = fine.nodeCount();
+        vector<int> order(n), match(n, -1);
+        for (int u = 0; u < n; ++u)
+            order[u] = u;
+        shuffle(order.begin(), order.end(), rng);
+
+        for (int u : order) {
+            if (match[u] != -1)
+                continue;
+            int best = u, bestWeight = -1;
+            for (int e = fine.offsets[u]; e < fine.offsets[u + 1]; ++e) {
+                int v = fine.targets[e];
+                if (v != u && match[v] == -1 && fine.edgeWeights[e] > bestWeight) {
+                    best = v;
+                    bestWeight = fine.edgeWeights[e];
+                }
+            }
+            match[u] = best;
+            match[best] = u;
+        }
+
+        fine.coarseOf.assign(n, -1);
+        int count = 0;
+        vector<int> firstMember;
+        for (int u = 0; u < n; ++u) {
+            if (fine.coarseOf[u] != -1)
+                continue;
+            fine.coarseOf[u] = fine.coarseOf[match[u]] = count++;
+            firstMember.push_back(u);
+        }
+
+        PartitionLevel coarse;
+        coarse.offsets.push_back(0);
+        coarse.nodeWeights.assign(count, 0);
+        vector<int> slot(count, -1);
+        for (int c = 0; c < count; ++c) {
+            int u = firstMember[c];
+            int members[2] = {u, match[u]};
+            int memberCount = (match[u] == u) ? 1 : 2;
+            int rowStart = (int)coarse.targets.size();
+            for (int m = 0; m < memberCount; ++m) {
+                int x = members[m];
+                coarse.nodeWeights[c] += fine.nodeWeights[x];
+                for (int e = fine.offsets[x]; e < fine.offsets[x + 1]; ++e) {
+                    int cv = fine.coarseOf[fine.targets[e]];
+                    if (cv == c)
+                        continue;
+                    if (slot[cv] == -1) {
+                        slot[cv] = (int)coarse.targets.size();
+                        coarse.targets.push_back(cv);
+                        coarse.edgeWeights.push_back(0);
+                    }
+                    coarse.edgeWeights[slot[cv]] += fine.edgeWeights[e];
+                }
+            }
+            for (int e = rowStart; e < (int)coarse.targets.size(); ++e)
+                slot[coarse.targets[e]] = -1;
+            coarse.offsets.push_back((int)coarse.targets.size());
+        }
+        return coarse;
+    }
+
+    // Grow each shard from a seed, always taking the node most connected to the shard so far
+    vector<int> initialPartition(const PartitionLevel& level, int k) {
+        int n = level.nodeCount();
+        long long total = 0;
+        for (int w : level.nodeWeights)
+            total += w;
+
+        vector<int> part(n, -1);
+        int next = 0;
+        for (int p = 0; p < k - 1; ++p) {
+            long long target = total * (p + 1) / k - total * p / k;
+            long long weight = 0;
+            vector<long long> conn(n, 0);
+            while (weight < target) {
+                int pick = -1;
+                for (int u = 0; u < n; ++u)
+                    if (part[u] == -1 && conn[u] > 0 && (pick == -1 || conn[u] > conn[pick]))
+                        pick = u;
+                if (pick == -1) {
+                    while (next < n && part[next] != -1)
+                        ++next;
+                    if (next == n)
+                        break;
+                    pick = next;
+                }
+                part[pick] = p;
+                weight += level.nodeWeights[pick];
+                for (int e = level.offsets[pick]; e < level.offsets[pick + 1]; ++e)
+                    conn[level.targets[e]] += level.edgeWeights[e];
+            }
+        }
+        for (int u = 0; u < n; ++u)
+            if (part[u] == -1)
+                part[u] = k - 1;
+        return part;
+    }
+
+    // Move boundary nodes to the neighbouring shard they are most connected to, within the balance limit.
+    // Nodes of an overweight shard may also move at a loss until the shard is back under the limit.
+    void refine(const PartitionLevel& level, vector<int>& part, int k, int maxWeight) {
+        int n = level.nodeCount();
+        vector<long long> partWeight(k, 0);
+        for (int u = 0; u < n; ++u)
+            partWeight[part[u]] += level.nodeWeights[u];
+
+        vector<long long> conn(k, 0);
+        vector<int> touched;
+        for (int pass = 0; pass < 8; ++pass) {
+            int moved = 0;
+            for (int u = 0; u < n; ++u) {
+                int from = part[u], w = level.nodeWeights[u];
+                touched.clear();
+                for (int e = level.offsets[u]; e < level.offsets[u + 1]; ++e) {
+                    int q = part[level.targets[e]];
+                    if (conn[q] == 0)
+                        touched.push_back(q);
+                    conn[q] += level.edgeWeights[e];
+                }
+                bool overweight = partWeight[from] > maxWeight;
+                int best = from;
+                long long bestGain = overweight ? LLONG_MIN : 0;
+                for (int q : touched) {
+                    if (q == from || partWeight[q] + w > maxWeight)
+                        continue;
+                    long long gain = conn[q] - conn[from];
+                    bool balances = partWeight[q] + w < partWeight[from];
+                    if (gain > bestGain || (gain == bestGain && balances && best == from)) {
+                        best = q;
+                        bestGain = gain;
+                    }
+                }
+                if (best == from && overweight) {
+                    for (int q = 0; q < k; ++q)
+                        if (partWeight[q] + w <= maxWeight && (best == from || partWeight[q] < partWeight[best]))
+                            best = q;
+                }
+                for (int q : touched)
+                    conn[q] = 0;
+                if (best != from && (bestGain > 0 || overweight || partWeight[best] + w < partWeight[from])) {
+                    part[u] = best;
+                    partWeight[from] -= w;
+                    partWeight[best] += w;
+                    ++moved;
+                }
+            }
+            if (moved == 0)
+                break;
+        }
+    }
+};
+
+#ifndef _WIN32
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0   // no such flag (e.g. macOS); the router sets SO_NOSIGPIPE on its sockets instead
+#endif
+
+// Function to write a whole buffer to a socket; a peer that has gone away fails the write instead of raising SIGPIPE
+bool writeAll(int fd, const void* data, size_t bytes)
+{
+    const char* p = (const char*)data;
+    while (bytes > 0) {
+        ssize_t written = send(fd, p, bytes, MSG_NOSIGNAL);
+        if (written <= 0)
+            return false;
+        p += written;
+        bytes -= written;
+    }
+    return true;
+}
 
+// Function to read a whole buffer from a socket
+bool readAll(int fd, void* data, size_t bytes)
 {
+    char* p = (char*)data;
+    while (bytes > 0) {
+        ssize_t got = read(fd, p, bytes);
+        if (got <= 0)
+            return false;
+        p += got;
+        bytes -= got;
+    }
+    return true;
+}
+
+// Class to answer shortest-distance queries over a network split into shard processes.
+// The shard processes are started before the network is partitioned, and each is then sent only its
+// own nodes and edges; it answers over a Unix socket with distances inside the shard. The coordinator
+// (this object) keeps no edges but the cut edges and the boundary-node distance tables, through which
+// it stitches the shard answers together. A shard that stops answering is reported and its queries fail.
+class ShardedRouter {
 public:
+    PartitionResult partitionInfo;
+
+    ShardedRouter(const Graph& g, int shardCount) {
+        shards.resize(shardCount);
+        if (!startShards())
+            return;
+
+        GraphPartitioner partitioner(g);
+        partitionInfo = partitioner.partition(shardCount);
+        const PartitionLevel& base = partitioner.base;
+        int n = (int)partitioner.nodeNames.size();
+        vector<int> meters;        // edge length for each entry of base.targets
+        meters.reserve(base.targets.size());
+        for (const auto& node : g.adj)
+            for (const auto& neighbor : node.second)
+                meters.push_back(neighbor.second);
+
+        vector<vector<int>> members(shardCount);
+        localId.assign(n, -1);
+        overlayId.assign(n, -1);
+        for (int u = 0; u < n; ++u) {
+            int s = partitionInfo.part[u];
+            localId[u] = (int)members[s].size();
+            members[s].push_back(u);
+        }
+        for (int u = 0; u < n; ++u) {
+            for (int e = base.offsets[u]; e < base.offsets[u + 1]; ++e) {
+                if (partitionInfo.part[base.targets[e]] != partitionInfo.part[u]) {
+                    overlayId[u] = (int)overlay.size();
+                    overlay.push_back(vector<pair<int, int64_t>>());
+                    shards[partitionInfo.part[u]].boundary.push_back(u);
+                    break;
+                }
+            }
+        }
+        for (int u = 0; u < n; ++u)
+            for (int e = base.offsets[u]; e < base.offsets[u + 1]; ++e) {
+                int v = base.targets[e];
+                if (partitionInfo.part[u] != partitionInfo.part[v])
+                    overlay[overlayId[u]].push_back(make_pair(overlayId[v], (int64_t)meters[e]));
+            }
 
-    int length; // in meters
-    int diameter; // in inches
-    string material; // Steel, PVC, etc.
-    double flow_rate; // in liters per second
-    double pressure; // in Pascals or PSI
-    string status; // Active, Inactive, Under Maintenance
-    string maintenance_schedule;
-    double cost; // Cost of the pipeline in currency
-    string leak_detection_type; // Leak detection type (Ultrasonic or Pressure Differential)
+        // Each shard's partition as {nodes, boundary count, boundary local ids, CSR offsets, targets, meters}
+        for (int s = 0; s < shardCount; ++s) {
+            vector<int32_t> message(3);
+            message.push_back((int32_t)members[s].size());
+            message.push_back((int32_t)shards[s].boundary.size());
+            for (int b : shards[s].boundary)
+                message.push_back(localId[b]);
+            vector<int32_t> targets, lengths;
+            message.push_back(0);
+            for (int u : members[s]) {
+                for (int e = base.offsets[u]; e < base.offsets[u + 1]; ++e)
+                    if (partitionInfo.part[base.targets[e]] == s) {
+                        targets.push_back(localId[base.targets[e]]);
+                        lengths.push_back(meters[e]);
+                    }
+                message.push_back((int32_t)targets.size());
+            }
+            message.insert(message.end(), targets.begin(), targets.end());
+            message.insert(message.end(), lengths.begin(), lengths.end());
+            message[0] = SHARD_LOAD;
+            message[1] = (int32_t)message.size() - 3;
+            message[2] = 0;
+            send(s, message.data(), message.size() * sizeof(int32_t));
+        }
+        nodeIds = move(partitioner.nodeIds);
 
+        loadBoundaryTables();
+        ready = failedShards() == 0;
+    }
 
-    Pipeline(int l, int d, string m, double fr, double p, string s, string ms, double c, string ldt)
-        : length(l),
-        diameter(d),
-        material(m),
-        flow_rate(fr),
-        pressure(p),
-        status(s),
-        maintenance_schedule(ms),
-        cost(c),
-          leak_detection_type(ldt) {}
+    ~ShardedRouter() {
+        int32_t request[3] = {SHARD_SHUTDOWN, 0, 0};
+        for (auto& shard : shards) {
+            if (shard.fd < 0)
+                continue;
+            writeAll(shard.fd, request, sizeof(request));
+            close(shard.fd);
+            waitpid(shard.pid, NULL, 0);
+        }
+    }
+
+    bool isReady() const {
+        return ready;
+    }
+
+    int failedShards() const {
+        int failed = 0;
+        for (const auto& shard : shards)
+            failed += shard.failed ? 1 : 0;
+        return failed;
+    }
+
+    // Shortest distance in meters between two areas, or -1 when no path exists or a shard has failed
+    int shortestDistance(const string& from, const string& to) {
+        auto fromIt = nodeIds.find(from);
+        auto toIt = nodeIds.find(to);
+        if (!ready || fromIt == nodeIds.end() || toIt == nodeIds.end())
+            return -1;
+        int s = fromIt->second, t = toIt->second;
+        int ps = partitionInfo.part[s], pt = partitionInfo.part[t];
+        if (shards[ps].failed || shards[pt].failed)
+            return -1;
+
+        // Both shard requests are in flight before either reply is read
+        int32_t fromRequest[3] = {SHARD_FROM_NODE, localId[s], ps == pt ? localId[t] : -1};
+        int32_t toRequest[3] = {SHARD_FROM_NODE, localId[t], -1};
+        send(ps, fromRequest, sizeof(fromRequest));
+        if (ps != pt)
+            send(pt, toRequest, sizeof(toRequest));
+        vector<int32_t> fromSide = readReply(ps);
+        if (ps == pt)
+            send(pt, toRequest, sizeof(toRequest));
+        vector<int32_t> toSide = readReply(pt);
+        if (fromSide.empty() || toSide.empty())
+            return -1;
+
+        int64_t best = fromSide.back();  // path that stays inside the shard (INF otherwise)
+        vector<int64_t> dist(overlay.size(), LLONG_MAX);
+        typedef pair<int64_t, int> QueueEntry;
+        priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry>> pq;
+        for (size_t i = 0; i < shards[ps].boundary.size(); ++i) {
+            int o = overlayId[shards[ps].boundary[i]];
+            if (fromSide[i] < DISTANCE_INF && fromSide[i] < dist[o]) {
+                dist[o] = fromSide[i];
+                pq.push(make_pair(dist[o], o));
+            }
+        }
+        while (!pq.empty()) {
+            int64_t du = pq.top().first;
+            int u = pq.top().second;
+            pq.pop();
+            if (du > dist[u])
+                continue;
+            for (const auto& e : overlay[u]) {
+                if (du + e.second < dist[e.first]) {
+                    dist[e.first] = du + e.second;
+                    pq.push(make_pair(dist[e.first], e.first));
+                }
+            }
+        }
+        for (size_t j = 0; j < shards[pt].boundary.size(); ++j) {
+            int o = overlayId[shards[pt].boundary[j]];
+            if (dist[o] != LLONG_MAX && toSide[j] < DISTANCE_INF)
+                best = min(best, dist[o] + toSide[j]);
+        }
+        return best >= DISTANCE_INF ? -1 : (int)best;
+    }
+
+private:
+    enum ShardOp { SHARD_SHUTDOWN = 0, SHARD_BOUNDARY_TABLE = 1, SHARD_FROM_NODE = 2, SHARD_LOAD = 3 };
+
+    struct Shard {
+        vector<int> boundary;  // global ids of nodes with an edge into another shard
+        pid_t pid = -1;
+        int fd = -1;
+        bool failed = false;
+    };
+
+    map<string, int> nodeIds;  // area name -> global id
+    vector<int> localId;       // position of each node inside its shard
+    vector<Shard> shards;
+    vector<int> overlayId;     // overlay node of each boundary node, -1 otherwise
+    vector<vector<pair<int, int64_t>>> overlay;
+    bool ready = false;
+
+    // Fork every shard process while this one holds no partition data yet
+    bool startShards() {
+        cout.flush();
+        for (size_t s = 0; s < shards.size(); ++s) {
+            int fds[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+                cout << "Could not create socket for shard " << s << endl;
+                return false;
+            }
+#ifdef SO_NOSIGPIPE
+            int on = 1;
+            setsockopt(fds[0], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+            setsockopt(fds[1], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+            pid_t pid = fork();
+            if (pid < 0) {
+                cout << "Could not start process for shard " << s << endl;
+                close(fds[0]);
+                close(fds[1]);
+                return false;
+            }
+            if (pid == 0) {
+                close(fds[0]);
+                for (size_t other = 0; other < s; ++other)
+                    close(shards[other].fd);
+                serveShard(fds[1]);
+                _exit(0);
+            }
+            close(fds[1]);
+            shards[s].pid = pid;
+            shards[s].fd = fds[0];
+        }
+        return true;
+    }
+
+    // Mark the shard failed, reporting it the first time
+    void fail(int s) {
+        if (!shards[s].failed)
+            cout << "Error: shard " << s << " (process " << shards[s].pid << ") stopped responding." << endl;
+        shards[s].failed = true;
+    }
+
+    bool send(int s, const void* data, size_t bytes) {
+        if (shards[s].failed || !writeAll(shards[s].fd, data, bytes)) {
+            fail(s);
+            return false;
+        }
+        return true;
+    }
+
+    vector<int32_t> readReply(int s) {
+        int32_t count = 0;
+        if (shards[s].failed || !readAll(shards[s].fd, &count, sizeof(count)) || count < 0) {
+            fail(s);
+            return vector<int32_t>();
+        }
+        vector<int32_t> reply(count);
+        if (count > 0 && !readAll(shards[s].fd, reply.data(), count * sizeof(int32_t))) {
+            fail(s);
+            return vector<int32_t>();
+        }
+        return reply;
+    }
+
+    // Link the boundary nodes of every shard by the shard's in-shard distance table
+    void loadBoundaryTables() {
+        int32_t request[3] = {SHARD_BOUNDARY_TABLE, 0, 0};
+        for (size_t s = 0; s < shards.size(); ++s)
+            send((int)s, request, sizeof(request));
+        for (size_t s = 0; s < shards.size(); ++s) {
+            const Shard& shard = shards[s];
+            if (shard.failed)
+                continue;
+            vector<int32_t> table = readReply((int)s);
+            size_t b = shard.boundary.size();
+            if (table.size() != b * b) {
+                fail((int)s);
+                continue;
+            }
+            for (size_t i = 0; i < b; ++i)
+                for (size_t j = 0; j < b; ++j)
+                    if (i != j && table[i * b + j] < DISTANCE_INF)
+                        overlay[overlayId[shard.boundary[i]]].push_back(
+                            make_pair(overlayId[shard.boundary[j]], (int64_t)table[i * b + j]));
+        }
+    }
+
+    // Runs in the shard process: builds its partition from the SHARD_LOAD message and answers requests
+    static void serveShard(int fd) {
+        int n = 0;
+        vector<int32_t> boundary;          // local ids
+        vector<int32_t> offsets(1, 0), targets, lengths;
+        vector<int32_t> dist;
+        auto runDijkstra = [&](int source) {
+            fill(dist.begin(), dist.end(), DISTANCE_INF);
+            typedef pair<int32_t, int> QueueEntry;
+            priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry>> pq;
+            dist[source] = 0;
+            pq.push(make_pair(0, source));
+            while (!pq.empty()) {
+                int32_t du = pq.top().first;
+                int u = pq.top().second;
+                pq.pop();
+                if (du > dist[u])
+                    continue;
+                for (int e = offsets[u]; e < offsets[u + 1]; ++e)
+                    if (du + lengths[e] < dist[targets[e]]) {
+                        dist[targets[e]] = du + lengths[e];
+                        pq.push(make_pair(dist[targets[e]], targets[e]));
+                    }
+            }
+        };
+
+        int32_t request[3];
+        vector<int32_t> reply;
+        while (readAll(fd, request, sizeof(request)) && request[0] != SHARD_SHUTDOWN) {
+            if (request[0] == SHARD_LOAD) {
+                vector<int32_t> body(max(request[1], 0));
+                if (!body.empty() && !readAll(fd, body.data(), body.size() * sizeof(int32_t)))
+                    break;
+                size_t at = 0;
+                n = body[at++];
+                boundary.assign(body.begin() + at + 1, body.begin() + at + 1 + body[at]);
+                at += 1 + boundary.size();
+                offsets.assign(body.begin() + at, body.begin() + at + n + 1);
+                at += n + 1;
+                targets.assign(body.begin() + at, body.begin() + at + offsets[n]);
+                lengths.assign(body.begin() + at + offsets[n], body.end());
+                dist.assign(n, DISTANCE_INF);
+                continue;
+            }
+            reply.assign(1, 0);
+            if (request[0] == SHARD_BOUNDARY_TABLE) {
+                for (int b : boundary) {
+                    runDijkstra(b);
+                    for (int other : boundary)
+                        reply.push_back(dist[other]);
+                }
+            } else if (request[0] == SHARD_FROM_NODE && request[1] >= 0 && request[1] < n) {
+                runDijkstra(request[1]);
+                for (int b : boundary)
+                    reply.push_back(dist[b]);
+                reply.push_back(request[2] >= 0 && request[2] < n ? dist[request[2]] : DISTANCE_INF);
+            }
+            reply[0] = (int32_t)reply.size() - 1;
+            if (!writeAll(fd, reply.data(), reply.size() * sizeof(int32_t)))
+                break;
+        }
+        close(fd);
+    }
+};
+
+// Function to benchmark partitioning and sharded queries on a synthetic city grid
+void benchmarkShardedRouting()
+{
+    const int side = 100;
+    const int shardCount = 4;
+    mt19937 rng(7);
+    uniform_int_distribution<int> meters(100, 2000);
+
+    Graph g;
+    for (int r = 0; r < side; ++r) {
+        for (int c = 0; c < side; ++c) {
+            string node = "Junction " + to_string(r * side + c);
+            if (c + 1 < side)
+                g.addEdge(node, "Junction " + to_string(r * side + c + 1), meters(rng));
+            if (r + 1 < side)
+                g.addEdge(node, "Junction " + to_string((r + 1) * side + c), meters(rng));
+        }
+    }
+
+    auto start = chrono::steady_clock::now();
+    ShardedRouter router(g, shardCount);
+    double setupMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    if (!router.isReady()) {
+        cout << "Sharded router could not be started." << endl;
+        return;
+    }
+
+    cout << "\nSharded routing benchmark (" << side * side << " junctions, " << shardCount << " shard processes)\n";
+    cout << "Partition + shard start-up: " << setupMs << " ms\n";
+    cout << "Edge cut: " << router.partitionInfo.edgeCut << " edges\nShard sizes:";
+    for (int w : router.partitionInfo.partWeight)
+        cout << " " << w;
+    cout << endl;
+
+    const int queries = 50;
+    int mismatches = 0;
+    double shardedMs = 0, directMs = 0;
+    for (int q = 0; q < queries; ++q) {
+        string from = "Junction " + to_string(rng() % (side * side));
+        string to = "Junction " + to_string(rng() % (side * side));
+
+        start = chrono::steady_clock::now();
+        int sharded = router.shortestDistance(from, to);
+        shardedMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        start = chrono::steady_clock::now();
+        int direct = g.dijkstra(from)[to];
+        directMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        if (sharded != (direct == INT_MAX ? -1 : direct))
+            ++mismatches;
+    }
+    cout << "Average sharded query: " << shardedMs / queries << " ms\n";
+    cout << "Average single-process Dijkstra: " << directMs / queries << " ms\n";
+    cout << "Mismatches: " << mismatches << " of " << queries << endl;
+}
+
+#endif
+
+// Function to benchmark Dijkstra for the different graph specializations on one random network
+void benchmarkGraphSpecializations()
+{
+    const uint32_t nodes = 50000;
+    const int sources = 20;
+    mt19937 rng(3);
+    uniform_int_distribution<int32_t> meters(100, 2000);
+
+    BasicGraph<int, string> byName;
+    BasicGraph<int32_t, uint32_t> byId;
+    BasicGraph<int32_t, uint32_t, BucketQueue> byIdBuckets;
+    BasicGraph<double, uint32_t> byCost;
+    vector<string> names(nodes);
+    for (uint32_t u = 0; u < nodes; ++u)
+        names[u] = "Junction " + to_string(u);
+    for (uint32_t u = 0; u < nodes; ++u) {
+        for (int e = 0; e < 2; ++e) {
+            uint32_t v = (e == 0) ? (u + 1) % nodes : rng() % nodes;
+            int32_t w = meters(rng);
+            byName.addEdge(names[u], names[v], w);
+            byId.addEdge(u, v, w);
+            byIdBuckets.addEdge(u, v, w);
+            byCost.addEdge(u, v, w * 1.5);
+        }
+    }
+
+    vector<uint32_t> starts(sources);
+    for (int i = 0; i < sources; ++i)
+        starts[i] = rng() % nodes;
+
+    long long checksum[3] = {0, 0, 0};
+    double ms[4];
+    auto start = chrono::steady_clock::now();
+    for (uint32_t s : starts) {
+        map<string, int> d = byName.dijkstra(names[s]);
+        checksum[0] += d[names[(s + 1) % nodes]];
+    }
+    ms[0] = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    for (uint32_t s : starts)
+        checksum[1] += byId.dijkstra(s)[(s + 1) % nodes];
+    ms[1] = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    for (uint32_t s : starts)
+        checksum[2] += byIdBuckets.dijkstra(s)[(s + 1) % nodes];
+    ms[2] = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    double costChecksum = 0;
+    for (uint32_t s : starts)
+        costChecksum += byCost.dijkstra(s)[(s + 1) % nodes];
+    ms[3] = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << "\nGraph specialization benchmark (" << nodes << " nodes, " << sources << " Dijkstra runs)\n";
+    cout << "int weights, string IDs (current):     " << ms[0] / sources << " ms per run\n";
+    cout << "int32_t weights, uint32_t IDs:          " << ms[1] / sources << " ms per run ("
+         << ms[0] / ms[1] << "x faster)\n";
+    cout << "int32_t weights, uint32_t IDs, buckets: " << ms[2] / sources << " ms per run ("
+         << ms[0] / ms[2] << "x faster)\n";
+    cout << "double cost weights, uint32_t IDs:      " << ms[3] / sources << " ms per run\n";
+    cout << "Results " << (checksum[0] == checksum[1] && checksum[1] == checksum[2] ? "match" : "DIFFER")
+         << " (cost checksum " << costChecksum << ")" << endl;
+}
+
+// Function to benchmark customer lookups in the open-addressing store against map<string, Customer>
+void benchmarkCustomerStore()
+{
+    cout << "Enter number of customers to load: ";
+    size_t count;
+    cin >> count;
+    if (count == 0) {
+        cout << "Nothing to benchmark." << endl;
+        return;
+    }
+
+    vector<Customer> batch;
+    batch.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        string id = "C" + to_string(100000 + i);
+        batch.push_back(Customer("Customer " + to_string(i), "Street " + to_string(i % 500), id,
+                                 "Udyambag", "Regular", "Monthly", (double)(i % 300), (double)(i % 40000)));
+    }
+    map<string, Customer> tree;
+    for (const Customer& c : batch)
+        tree[c.customer_id] = c;
+
+    CustomerStore store;
+    auto start = chrono::steady_clock::now();
+    store.bulkLoad(batch);
+    double loadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    const size_t lookups = 2000000;
+    vector<string> probes(4096);
+    mt19937 rng(5);
+    for (string& id : probes)
+        id = "C" + to_string(100000 + rng() % count);
+
+    double sum = 0;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < lookups; ++i)
+        sum += store.find(probes[i & 4095])->total_amount;
+    double storeSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < lookups; ++i)
+        sum -= tree.find(probes[i & 4095])->second.total_amount;
+    double treeSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "\nCustomer store benchmark (" << count << " customers)\n";
+    cout << "Bulk load: " << loadMs << " ms\n";
+    cout << "Open-addressing lookups: " << lookups / storeSec / 1e6 << " million per second\n";
+    cout << "map<string, Customer> lookups: " << lookups / treeSec / 1e6 << " million per second\n";
+    cout << "Checksum: " << sum << endl;
+}
+
+// Function to benchmark the compressed usage time-series against parsing vector<string> records
+void benchmarkUsageSeries()
+{
+    cout << "Enter number of customers: ";
+    int customers;
+    cin >> customers;
+    cout << "Enter years of hourly meter readings: ";
+    int years;
+    cin >> years;
+    if (customers <= 0 || years <= 0) {
+        cout << "Nothing to benchmark." << endl;
+        return;
+    }
+
+    const int64_t start = 1704067200;   // 01-Jan-2024 00:00 UTC
+    const int64_t hour = 3600, day = 24 * hour;
+    const int readingsPerCustomer = years * 365 * 24;
+    mt19937 rng(7);
+    uniform_real_distribution<double> flow(0.0, 40.0);
+
+    UsageArena arena;
+    vector<UsageSeries> series(customers);
+    vector<vector<string>> text(customers);
+    auto begin = chrono::steady_clock::now();
+    for (int i = 0; i < readingsPerCustomer; ++i)
+        for (int c = 0; c < customers; ++c) {
+            double volume = round(flow(rng) * 1000.0) / 1000.0;
+            series[c].append(arena, UsageReading{start + i * hour, volume, round(volume * 2.5 * 100.0) / 100.0});
+        }
+    double appendMs = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+
+    // Same readings as free-text records, the way usage_history used to hold them
+    size_t textBytes = 0;
+    for (int c = 0; c < customers; ++c) {
+        series[c].forEach(arena, INT64_MIN, INT64_MAX, [&](const UsageReading& r) {
+            text[c].push_back(to_string(r.timestamp) + "," + to_string(r.volume) + "," + to_string(r.amount));
+            textBytes += sizeof(string) + (text[c].back().size() > 15 ? text[c].back().size() + 1 : 0);
+        });
+    }
+
+    // Monthly (30-day) totals of the last year, per customer
+    int64_t from = start + (int64_t)(years - 1) * 365 * day, to = start + (int64_t)years * 365 * day - 1;
+    begin = chrono::steady_clock::now();
+    double checksum = 0;
+    for (int c = 0; c < customers; ++c)
+        for (const UsageTotals& w : series[c].windowedSums(arena, from, to, 30 * day))
+            checksum += w.volume;
+    double windowMs = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+
+    begin = chrono::steady_clock::now();
+    double textChecksum = 0;
+    for (int c = 0; c < customers; ++c)
+        for (const string& record : text[c]) {
+            size_t comma = record.find(',');
+            int64_t time = stoll(record.substr(0, comma));
+            if (time >= from && time <= to)
+                textChecksum += stod(record.substr(comma + 1, record.find(',', comma + 1) - comma - 1));
+        }
+    double textMs = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+
+    begin = chrono::steady_clock::now();
+    double allTime = 0;
+    for (int c = 0; c < customers; ++c)
+        allTime += series[c].sum(arena, INT64_MIN, INT64_MAX).amount;
+    double sumMs = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+
+    uint64_t readings = (uint64_t)customers * readingsPerCustomer;
+    cout << "\nUsage time-series benchmark (" << customers << " customers, " << readings << " readings)\n";
+    cout << "Append: " << appendMs << " ms, " << (double)arena.bytes() / readings << " bytes per reading (strings: "
+         << (double)textBytes / readings << ")\n";
+    cout << "Monthly sums of the last year, series:  " << windowMs << " ms (" << checksum << ")\n";
+    cout << "Same by parsing string records:         " << textMs << " ms (" << textChecksum << ")\n";
+    cout << "All-time amount per customer, series:   " << sumMs << " ms (" << allTime << ")" << endl;
+}
+
+// Function to benchmark the durable customer store: logged writes, snapshot and recovery
+void benchmarkDurableStore()
+{
+    cout << "Enter number of customer writes: ";
+    int count;
+    cin >> count;
+    cout << "Enter number of writer threads: ";
+    int writers;
+    cin >> writers;
+    if (count <= 0 || writers <= 0) {
+        cout << "Nothing to benchmark." << endl;
+        return;
+    }
+
+    const string path = "benchmark_customers";
+    const char* files[] = {".wal", ".snapshot"};
+    for (const char* suffix : files)
+        remove((path + suffix).c_str());
+    auto makeCustomer = [](int i) {
+        Customer c("Customer " + to_string(i), "Street " + to_string(i % 500), "C" + to_string(100000 + i),
+                   "Udyambag", i % 2 ? "Regular" : "Emergency", "Monthly", (double)(i % 300), (double)(i % 40000));
+        c.pipelines.push_back(Pipeline(120 + i % 80, 12, "Steel", 20.5, 250, "Active", "Monthly", 0.0, "Ultrasonic"));
+        return c;
+    };
+
+    double writeMs, batchMs, snapshotMs, recoverMs;
+    uint64_t syncs;
+    {
+        DurableCustomerStore store;
+        if (!store.open(path))
+            return;
+        // Writers that each wait for their own commit
+        auto start = chrono::steady_clock::now();
+        vector<thread> threads;
+        for (int t = 0; t < writers; ++t)
+            threads.push_back(thread([&store, &makeCustomer, t, writers, count]() {
+                for (int i = t; i < count; i += writers)
+                    store.put(makeCustomer(i));
+            }));
+        for (thread& t : threads)
+            t.join();
+        writeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        syncs = store.logSyncs();
+
+        // The same number of updates in batches of 1000
+        start = chrono::steady_clock::now();
+        vector<Customer> batch;
+        for (int i = 0; i < count; ++i) {
+            Customer c = makeCustomer(i);
+            c.total_amount += 1;
+            batch.push_back(c);
+            if (batch.size() == 1000 || i == count - 1) {
+                store.putBatch(batch);
+                batch.clear();
+            }
+        }
+        batchMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        start = chrono::steady_clock::now();
+        store.snapshot();
+        snapshotMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        // Leave a log tail behind for recovery to replay
+        for (int i = 0; i < count / 10; ++i)
+            batch.push_back(makeCustomer(i));
+        store.putBatch(batch);
+    }
+
+    DurableCustomerStore reopened;
+    auto start = chrono::steady_clock::now();
+    reopened.open(path);
+    recoverMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << "\nDurable customer store benchmark (" << count << " customers)\n";
+    cout << "Single writes, " << writers << " threads: " << writeMs << " ms, " << count / (writeMs / 1000.0)
+         << " writes/s, " << syncs << " log syncs (" << (double)count / max<uint64_t>(syncs, 1) << " writes per sync)\n";
+    cout << "Batched writes:  " << batchMs << " ms, " << count / (batchMs / 1000.0) << " writes/s\n";
+    cout << "Snapshot:        " << snapshotMs << " ms\n";
+    cout << "Recovery:        " << recoverMs << " ms (" << reopened.size() << " customers, "
+         << reopened.replayedRecords() << " log records replayed)" << endl;
+    reopened.close();
+    for (const char* suffix : files)
+        remove((path + suffix).c_str());
+}
+
+// Function to benchmark filter expressions over the columns against checking every Customer object
+void benchmarkCustomerQuery()
+{
+    cout << "Enter number of customers to load: ";
+    size_t count;
+    cin >> count;
+
+    const char* locations[] = {"Udyambag", "Tilakwadi", "Shahapur", "Angol", "Khade Bazar"};
+    const char* supplyTypes[] = {"Regular", "Emergency", "Standard", "Premium"};
+    const char* cycles[] = {"Monthly", "Quarterly", "Weekly"};
+    vector<Customer> batch;
+    batch.reserve(count);
+    mt19937 rng(11);
+    for (size_t i = 0; i < count; ++i)
+        batch.push_back(Customer("", "", "C" + to_string(100000 + i), locations[rng() % 5], supplyTypes[rng() % 4],
+                                 cycles[rng() % 3], (double)(rng() % 300), (double)(rng() % 40000)));
+    CustomerStore store;
+    store.bulkLoad(batch);
+
+    const char* filters[] = {
+        "total_amount > 20000",
+        "total_amount > 20000 AND billing_cycle = Quarterly",
+        "(location = Udyambag OR location = Tilakwadi) AND NOT supply_type = Premium AND total_usage <= 100",
+    };
+    cout << "\nCustomer query benchmark (" << count << " customers)\n";
+    for (const char* filter : filters) {
+        CustomerQuery query(store);
+        query.compile(filter);
+        auto start = chrono::steady_clock::now();
+        size_t matches = query.count();
+        double queryMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        // The same filter hand-written over the Customer objects
+        string wanted = filter;
+        start = chrono::steady_clock::now();
+        size_t expected = 0;
+        for (const Customer& c : store) {
+            if (wanted == filters[0])
+                expected += c.total_amount > 20000;
+            else if (wanted == filters[1])
+                expected += c.total_amount > 20000 && c.billing_cycle == "Quarterly";
+            else
+                expected += (c.location == "Udyambag" || c.location == "Tilakwadi") && !(c.supply_type == "Premium") && c.total_usage <= 100;
+        }
+        double objectMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        cout << filter << "\n  columns: " << queryMs << " ms (" << count / (queryMs / 1000.0) / 1e6 << "M rows/s), "
+             << matches << " matches; objects: " << objectMs << " ms, " << expected << " matches\n";
+    }
+    cout << flush;
+}
+
+// Function to benchmark a billing run over a large synthetic customer base at 1 thread and at every hardware thread
+void benchmarkBillingRun()
+{
+    cout << "Enter number of customers to bill: ";
+    size_t count;
+    cin >> count;
+
+    const char* locations[] = {"Udyambag", "Tilakwadi", "Shahapur", "Angol", "Khade Bazar"};
+    const char* supplyTypes[] = {"Regular", "Emergency"};
+    const char* cycles[] = {"Monthly", "Quarterly", "Weekly"};
+    vector<Customer> batch;
+    batch.reserve(count);
+    mt19937 rng(13);
+    for (size_t i = 0; i < count; ++i)
+        batch.push_back(Customer("Customer " + to_string(i), "", "C" + to_string(100000 + i), locations[rng() % 5],
+                                 supplyTypes[rng() % 2], cycles[rng() % 3], (double)(rng() % 300), (double)(rng() % 40000)));
+    CustomerStore store;
+    store.bulkLoad(batch);
+
+    const string path = "benchmark_invoices.txt";
+    int hardwareThreads = (int)max(1u, thread::hardware_concurrency());
+    cout << "\nBilling run benchmark (" << count << " customers)\n";
+    for (int threads : {1, hardwareThreads}) {
+        FILE* out = fopen(path.c_str(), "wb");
+        if (!out) {
+            cout << "Error: could not create " << path << endl;
+            return;
+        }
+        BillingRun run(store, waterSupplyTariff);
+        BillingReport report = run.run(out, "Benchmark", threads);
+        fclose(out);
+        cout << threads << " thread(s): " << report.milliseconds << " ms, " << report.customersPerSecond()
+             << " customers/s, billed " << report.usageCharges + report.supplyCharges << "\n";
+        if (hardwareThreads == 1)
+            break;
+    }
+    cout << flush;
+    remove(path.c_str());
+}
+
+// Function to benchmark taxing and totalling bills with Money (one at a time and in batches) against double,
+// and to show that only the Money totals come out the same when the bills are added up in another order
+void benchmarkMoney()
+{
+    cout << "Enter number of bills: ";
+    size_t count;
+    cin >> count;
+    if (count == 0) {
+        cout << "Nothing to benchmark." << endl;
+        return;
+    }
+
+    mt19937_64 rng(17);
+    vector<Money> bills(count), taxes(count), totals(count);
+    vector<double> billRupees(count);
+    for (size_t i = 0; i < count; ++i) {
+        bills[i] = Money::fromPaise((int64_t)(rng() % 5000000));
+        billRupees[i] = bills[i].rupees();
+    }
+    Percentage rate = Percentage::basisPoints(1850);   // 18.5%
+
+    auto start = chrono::steady_clock::now();
+    double doubleTotal = 0;
+    for (size_t i = 0; i < count; ++i)
+        doubleTotal += billRupees[i] + billRupees[i] * 18.5 / 100;
+    double doubleMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    // The same bills added up in four interleaved chunks, as four threads would
+    double chunkTotals[4] = {0, 0, 0, 0};
+    for (size_t i = 0; i < count; ++i)
+        chunkTotals[i % 4] += billRupees[i] + billRupees[i] * 18.5 / 100;
+    double doubleChunked = (chunkTotals[0] + chunkTotals[1]) + (chunkTotals[2] + chunkTotals[3]);
+
+    start = chrono::steady_clock::now();
+    Money singleTotal;
+    for (size_t i = 0; i < count; ++i)
+        singleTotal += bills[i] + rate.of(bills[i]);
+    double singleMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    applyTax(bills.data(), count, rate, taxes.data(), totals.data());
+    Money batchTotal = sumMoney(totals.data(), count);
+    double batchMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout.precision(15);
+    cout << "\nMoney benchmark (" << count << " bills, tax " << rate << "%)\n";
+    cout << "double:         " << doubleMs << " ms, total " << doubleTotal << " (in four chunks: " << doubleChunked
+         << (doubleTotal == doubleChunked ? ", same)\n" : ", differs)\n");
+    cout << "Money, single:  " << singleMs << " ms, total " << singleTotal << "\n";
+    cout << "Money, batch:   " << batchMs << " ms, total " << batchTotal
+         << (batchTotal == singleTotal ? " (matches single)" : " (MISMATCH)") << endl;
+    cout.precision(6);
+}
+
+// Function to benchmark supply tariff lookups in the compile-time grid against nested string maps
+void benchmarkTariffLookups()
+{
+    cout << "Enter number of lookups: ";
+    size_t count;
+    cin >> count;
+
+    map<string, map<string, double>> nestedPricing = {
+        {"Regular", {{"Monthly", 100.0}, {"Quarterly", 250.0}, {"Weekly", 25.0}}},
+        {"Emergency", {{"Monthly", 200.0}, {"Quarterly", 500.0}, {"Weekly", 50.0}}}
+    };
+    const char* supplyNames[] = {"Regular", "Emergency"};
+    const char* cycleNames[] = {"Monthly", "Quarterly", "Weekly"};
+    vector<pair<SupplyType, BillingCycle>> keys;
+    vector<pair<string, string>> names;
+    mt19937 rng(19);
+    for (size_t i = 0; i < 4096; ++i) {
+        const char* supply = supplyNames[rng() % 2];
+        const char* cycle = cycleNames[rng() % 3];
+        keys.push_back(make_pair(SupplyType(supply), BillingCycle(cycle)));
+        names.push_back(make_pair(supply, cycle));
+    }
+
+    auto start = chrono::steady_clock::now();
+    double mapTotal = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const pair<string, string>& key = names[i & 4095];
+        mapTotal += nestedPricing[key.first][key.second];
+    }
+    double mapMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    Money gridTotal;
+    for (size_t i = 0; i < count; ++i) {
+        const pair<SupplyType, BillingCycle>& key = keys[i & 4095];
+        gridTotal += waterSupplyTariff.at(key.first, key.second);
+    }
+    double gridMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << "\nTariff lookup benchmark (" << count << " lookups)\n";
+    cout << "Nested string maps: " << mapMs << " ms (" << count / (mapMs / 1000.0) / 1e6 << "M lookups/s), total " << mapTotal << "\n";
+    cout << "Tariff grid:        " << gridMs << " ms (" << count / (gridMs / 1000.0) / 1e6 << "M lookups/s), total " << gridTotal << endl;
+}
+
+// Function to benchmark charging usage by slab in batches against a band-by-band loop with branches
+void benchmarkSlabTariff()
+{
+    cout << "Enter number of usage values: ";
+    size_t count;
+    cin >> count;
+    if (count == 0) {
+        cout << "Nothing to benchmark." << endl;
+        return;
+    }
+
+    // 0-10 at 5.00, 10-25 at 7.50, 25+ at 10.00, minimum 50.00, peak hours at 120%
+    SlabTariff tariff;
+    tariff.addSlab(10, Money::fromRupees(5));
+    tariff.addSlab(25, Money::fromRupees(7, 50));
+    tariff.addSlab(INFINITY, Money::fromRupees(10));
+    tariff.setTimeOfDay(SlabTariff::Peak, 18, 22, Percentage::basisPoints(12000));
+    Money minimum = Money::fromRupees(50);
+    tariff.setMinimumCharge(minimum);
+    double bounds[] = {0, 10, 25, INFINITY};
+    Money rates[] = {Money::fromRupees(5), Money::fromRupees(7, 50), Money::fromRupees(10)};
+
+    mt19937 rng(23);
+    vector<double> units(count);
+    vector<uint8_t> periods(count);
+    for (size_t i = 0; i < count; ++i) {
+        units[i] = (rng() % 6000) / 100.0;   // 0 to 60 units
+        periods[i] = rng() % 4 == 0 ? SlabTariff::Peak : SlabTariff::Standard;
+    }
+    vector<Money> charges(count);
+
+    auto start = chrono::steady_clock::now();
+    Money loopTotal;
+    for (size_t i = 0; i < count; ++i) {
+        double paise = 0;
+        for (int b = 0; b < 3; ++b) {
+            if (units[i] <= bounds[b])
+                break;
+            paise += (min(units[i], bounds[b + 1]) - bounds[b]) * rates[b].paise();
+        }
+        if (periods[i] == SlabTariff::Peak)
+            paise *= 1.2;
+        Money charge = Money::fromPaise(Money::roundHalfAway(paise));
+        loopTotal += charge < minimum ? minimum : charge;
+    }
+    double loopMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    tariff.chargeBatch(units.data(), periods.data(), count, charges.data());
+    Money batchTotal = sumMoney(charges.data(), count);
+    double batchMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; i += 97)
+        mismatches += tariff.charge(units[i], (SlabTariff::Period)periods[i]) != charges[i];
+
+    cout << "\nSlab tariff benchmark (" << count << " usage values)\n";
+    cout << "Band loop: " << loopMs << " ms (" << count / (loopMs / 1000.0) / 1e6 << "M values/s), total " << loopTotal << "\n";
+    cout << "Batch:     " << batchMs << " ms (" << count / (batchMs / 1000.0) / 1e6 << "M values/s), total " << batchTotal
+         << ", " << mismatches << " differences from single charges" << endl;
+}
+
+// Function to benchmark closing a billing cycle from the running accumulators against summing the usage history
+void benchmarkBillingAccumulators()
+{
+    cout << "Enter number of customers: ";
+    size_t count;
+    cin >> count;
+    cout << "Enter number of readings per customer: ";
+    size_t readings;
+    cin >> readings;
+    if (count == 0 || readings == 0) {
+        cout << "Nothing to benchmark." << endl;
+        return;
+    }
+
+    UsageArena arena;
+    vector<UsageSeries> series(count);
+    vector<BillingAccumulator> accumulators(count);
+    mt19937 rng(29);
+    const int64_t start = 1735689600;   // 1-Jan-2025
+    auto begin = chrono::steady_clock::now();
+    for (size_t r = 0; r < readings; ++r)
+        for (size_t i = 0; i < count; ++i) {
+            UsageReading reading{start + (int64_t)r * 900, (rng() % 5000) / 1000.0, (rng() % 20000) / 100.0};
+            series[i].append(arena, reading);
+            accumulators[i].add(reading);
+        }
+    double appendMs = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+    int64_t closedAt = start + (int64_t)readings * 900;
+
+    begin = chrono::steady_clock::now();
+    Money scanTotal;
+    vector<UsageTotals> scanned(count);
+    for (size_t i = 0; i < count; ++i) {
+        scanned[i] = series[i].sum(arena, start, closedAt);
+        scanTotal += Money::fromPaise(llround(scanned[i].amount * 100.0));
+    }
+    double scanMs = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+
+    begin = chrono::steady_clock::now();
+    Money closeTotal;
+    size_t differences = 0;
+    for (size_t i = 0; i < count; ++i) {
+        BillingCycleTotals closed = accumulators[i].close(closedAt);
+        closeTotal += closed.amount;
+        differences += closed.readings != scanned[i].readings || closed.volume != scanned[i].volume;
+    }
+    double closeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+
+    cout << "\nBilling accumulator benchmark (" << count << " customers x " << readings << " readings)\n";
+    cout << "Appending readings (series + accumulator): " << appendMs << " ms\n";
+    cout << "Cycle close by summing the history:       " << scanMs << " ms, amount " << scanTotal << "\n";
+    cout << "Cycle close from the accumulators:        " << closeMs << " ms, amount " << closeTotal << ", "
+         << differences << " customers differ" << endl;
+}
+
+// Function to benchmark the receivables aging job against scanning bills that keep the due date as text
+void benchmarkReceivablesAging()
+{
+    cout << "Enter number of open bills: ";
+    size_t count;
+    cin >> count;
+    if (count == 0) {
+        cout << "Nothing to benchmark." << endl;
+        return;
+    }
+
+    // Bills due over the last 150 days and the next 30, as the gas section records them
+    struct TextBill {
+        string dueDate, paymentStatus;
+        Money amount;
+    };
+    const int32_t asOf = 20089;     // 1-Jan-2025
+    const Percentage rate = Percentage::basisPoints(150);
+    mt19937 rng(47);
+    vector<TextBill> textBills(count);
+    Receivables receivables(rate);
+    auto begin = chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        int32_t due = asOf - 150 + (int32_t)(rng() % 180);
+        textBills[i] = {formatDay(due), "no", Money::fromPaise(10000 + rng() % 500000)};
+    }
+    double generateMs = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+    begin = chrono::steady_clock::now();
+    for (const TextBill& b : textBills)
+        receivables.add(b.dueDate, b.amount);
+    double ingestMs = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+
+    // Baseline: parse every due date and scan every bill each night
+    begin = chrono::steady_clock::now();
+    AgingReport scanned;
+    for (const TextBill& b : textBills) {
+        int32_t due;
+        if (b.paymentStatus == "yes" || !parseDay(b.dueDate, due))
+            continue;
+        int32_t days = asOf - due;
+        AgingReport::Bucket bucket = AgingReport::bucketOf(days);
+        scanned.bills[bucket]++;
+        scanned.amount[bucket] += b.amount;
+        if (days > 0)
+            scanned.penalties += Money::fromPaise(Percentage::applyBasisPoints(b.amount.paise(), rate.basisPoints() * ((days + 29) / 30)));
+    }
+    double scanMs = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+
+    AgingReport oneThread = receivables.age(asOf, 1);
+    AgingReport allThreads = receivables.age(asOf);
+    bool same = oneThread.penalties == scanned.penalties && allThreads.penalties == scanned.penalties;
+    for (int b = 0; b < AgingReport::BUCKETS; ++b)
+        same = same && oneThread.bills[b] == scanned.bills[b] && oneThread.amount[b] == scanned.amount[b]
+               && allThreads.amount[b] == scanned.amount[b];
+
+    // Pay a tenth of the bills, then run the next night
+    for (uint32_t bill = 0; bill < count; bill += 10)
+        receivables.settle(bill);
+    AgingReport nextNight = receivables.age(asOf + 1);
+
+    cout << "\nReceivables aging benchmark (" << count << " open bills, " << thread::hardware_concurrency() << " hardware threads)\n";
+    cout << "Generating bills:                        " << generateMs << " ms\n";
+    cout << "Ingesting (parsing due dates, indexing): " << ingestMs << " ms\n";
+    cout << "Scan parsing text due dates:             " << scanMs << " ms\n";
+    cout << "Aging job, 1 thread:                     " << oneThread.milliseconds << " ms\n";
+    cout << "Aging job, all threads:                  " << allThreads.milliseconds << " ms ("
+         << (same ? "same" : "DIFFERENT") << " buckets and penalties as the scan; "
+         << allThreads.newPenalties << " rupees re-charged on the second run)\n";
+    cout << "Next night after a tenth are paid:       " << nextNight.milliseconds << " ms\n\n";
+    nextNight.display();
+}
+
+// Function to benchmark combined invoices in one pass over the accounts against billing each service in its own pass
+void benchmarkUtilityBilling()
+{
+    cout << "Enter number of customers to bill: ";
+    size_t count;
+    cin >> count;
+    if (count == 0) {
+        cout << "Nothing to benchmark." << endl;
+        return;
+    }
+
+    const char* supplyTypes[] = {"Regular", "Emergency"};
+    const char* connectionTypes[] = {"Residential", "Commercial"};
+    const char* cycles[] = {"Monthly", "Quarterly", "Weekly"};
+    vector<ServiceAccount> accounts(count);
+    mt19937 rng(48);
+    for (size_t i = 0; i < count; ++i) {
+        ServiceAccount& a = accounts[i];
+        a.customer_id = "C" + to_string(100000 + i);
+        a.name = "Customer " + to_string(i);
+        a.billing_cycle = cycles[rng() % 3];
+        for (int s = 0; s < ServiceAccount::SERVICES; ++s)
+            if (rng() % 3 != 0)
+                a.add((ServiceAccount::Service)s);
+        if (a.services == 0)
+            a.add(ServiceAccount::Water);
+        a.supply_type = supplyTypes[rng() % 2];
+        a.water_usage = (rng() % 30000) / 100.0;
+        a.water_amount = Money::fromPaise(rng() % 4000000);
+        a.connection_type = connectionTypes[rng() % 2];
+        a.electricity_units = (rng() % 50000) / 100.0;
+        a.gas_units = (rng() % 10000) / 100.0;
+        a.wifi_activation = rng() % 20 == 0;
+    }
+
+    SlabTariff waterSlabs, electricitySlabs, gasSlabs;
+    bool haveWaterSlabs = SlabTariff::load(SLAB_TARIFF_CONFIG, "water", waterSlabs);
+    bool haveElectricitySlabs = SlabTariff::load(SLAB_TARIFF_CONFIG, "electricity", electricitySlabs);
+    bool haveGasSlabs = SlabTariff::load(SLAB_TARIFF_CONFIG, "gas", gasSlabs);
+    WaterTariff water{&waterSupplyTariff, haveWaterSlabs ? &waterSlabs : NULL};
+    ElectricityTariff electricity{&electricityConnectionTariff, {haveElectricitySlabs ? &electricitySlabs : NULL, Money::fromRupees(7)}};
+    GasTariff gas{{haveGasSlabs ? &gasSlabs : NULL, Money::fromRupees(45)}, Percentage::basisPoints(500)};
+    WiFiTariff wifi{Money::fromRupees(799), Money::fromRupees(1500)};
+
+    const string path = "benchmark_utility_invoices.txt";
+    auto open = [&path](const char* mode) {
+        FILE* out = fopen(path.c_str(), mode);
+        if (!out)
+            cout << "Error: could not create " << path << endl;
+        return out;
+    };
+
+    FILE* out = open("wb");
+    if (!out)
+        return;
+    UtilityBillingReport combined = UtilityBilling<WaterTariff, ElectricityTariff, GasTariff, WiFiTariff>(water, electricity, gas, wifi)
+                                         .run(accounts, out, "Benchmark");
+    fclose(out);
+
+    // The same charges the way the four programs bill: one pass per service, each over every customer
+    UtilityBillingReport separate[ServiceAccount::SERVICES];
+    out = open("wb");
+    if (!out)
+        return;
+    separate[0] = UtilityBilling<WaterTariff>(water).run(accounts, out, "Benchmark");
+    separate[1] = UtilityBilling<ElectricityTariff>(electricity).run(accounts, out, "Benchmark");
+    separate[2] = UtilityBilling<GasTariff>(gas).run(accounts, out, "Benchmark");
+    separate[3] = UtilityBilling<WiFiTariff>(wifi).run(accounts, out, "Benchmark");
+    fclose(out);
+    remove(path.c_str());
+
+    double separateMs = 0;
+    size_t separateInvoices = 0;
+    Money separateTotal;
+    for (const UtilityBillingReport& r : separate) {
+        separateMs += r.milliseconds;
+        separateInvoices += r.invoiced;
+        separateTotal += r.total;
+    }
+    cout << "\nCombined utility billing benchmark (" << count << " customers, " << combined.charges << " service charges)\n";
+    cout << "One pass, combined invoices:  " << combined.milliseconds << " ms, " << combined.invoiced << " invoices, "
+         << combined.customersPerSecond() << " customers/s\n";
+    cout << "Four passes, one per service: " << separateMs << " ms, " << separateInvoices << " invoices\n";
+    cout << "Totals: " << combined.total << " vs " << separateTotal << " ("
+         << (combined.total == separateTotal ? "same" : "DIFFERENT") << ")\n";
+    for (int s = 0; s < ServiceAccount::SERVICES; ++s)
+        cout << "  " << ServiceAccount::NAMES[s] << ": " << combined.byService[s] << endl;
+}
+
+// Function to benchmark repeated installation quotes with and without the quote cache, and that a tariff or
+// network change is picked up by the next quote
+void benchmarkInstallationQuotes()
+{
+    cout << "Enter number of quotes: ";
+    size_t count;
+    cin >> count;
+    if (count == 0) {
+        cout << "Nothing to benchmark." << endl;
+        return;
+    }
+
+    const int side = 60;
+    mt19937 rng(49);
+    uniform_int_distribution<int> meters(100, 2000);
+    Graph g;
+    for (int r = 0; r < side; ++r)
+        for (int c = 0; c < side; ++c) {
+            string node = "Junction " + to_string(r * side + c);
+            if (c + 1 < side)
+                g.addEdge(node, "Junction " + to_string(r * side + c + 1), meters(rng));
+            if (r + 1 < side)
+                g.addEdge(node, "Junction " + to_string((r + 1) * side + c), meters(rng));
+        }
+    MaterialRateTable materialRates = {{"Steel", 900.0}, {"PVC", 400.0}, {"Concrete", 650.0}};
+    ReloadableSupplyPricing supplyPricing(waterSupplyTariff);
+    RouteCostEngine<Graph, MaterialRateTable, ReloadableSupplyPricing> costEngine(g, materialRates, supplyPricing);
+
+    // Customers going back and forth between selections at a few hundred locations
+    const PipeMaterial materials[] = {"Steel", "PVC", "Concrete"};
+    const SupplyType supplyTypes[] = {"Regular", "Emergency"};
+    const BillingCycle cycles[] = {"Monthly", "Quarterly", "Weekly"};
+    struct Request {
+        string location;
+        PipeMaterial material;
+        SupplyType supplyType;
+        BillingCycle cycle;
+    };
+    vector<Request> requests(count);
+    for (Request& r : requests)
+        r = {"Junction " + to_string(rng() % 300 * 12), materials[rng() % 3], supplyTypes[rng() % 2], cycles[rng() % 3]};
+
+    // Cold quotes (network flattened, Dijkstra and pricing every time) are slow, so only a sample is timed
+    size_t sample = min<size_t>(count, 200);
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < sample; ++i) {
+        costEngine.invalidate();
+        costEngine.quote(requests[i].location, requests[i].material, requests[i].supplyType, requests[i].cycle);
+    }
+    double coldMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / sample;
+
+    costEngine.invalidate();
+    start = chrono::steady_clock::now();
+    Money cachedTotal;
+    for (const Request& r : requests)
+        cachedTotal += costEngine.quote(r.location, r.material, r.supplyType, r.cycle).total;
+    double cachedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    uint64_t hits = costEngine.cacheHits(), misses = costEngine.cacheMisses();
+
+    // A new steel rate and a shorter pipe must both show up in the next quote
+    const Request& first = requests[0];
+    Money before = costEngine.quote(first.location, "Steel", first.supplyType, first.cycle).total;
+    materialRates.set("Steel", Money::fromRupees(1800));
+    Money afterRate = costEngine.quote(first.location, "Steel", first.supplyType, first.cycle).total;
+    g.addEdge(first.location, "Pump Station", 1);
+    const InstallationQuote& afterEdit = costEngine.quote(first.location, "Steel", first.supplyType, first.cycle);
+
+    cout << "\nInstallation quote benchmark (" << count << " quotes, " << side * side << " junctions)\n";
+    cout << "Cold quote (no cached routes or quotes): " << coldMs * 1000 << " us each\n";
+    cout << "With the caches:                         " << cachedMs * 1000 / count << " us each, " << cachedMs << " ms in all, total "
+         << cachedTotal << " (" << hits << " hits, " << misses << " misses)\n";
+    cout << "Quote at " << first.location << " in steel: " << before << ", after the steel rate changed: " << afterRate
+         << ", after a pump station was added next door: " << afterEdit.total << " (to " << afterEdit.destination << ")" << endl;
+}
+
+// Function to benchmark the batch bill-of-materials kernel against calling calculatePipeVolume and
+// calculateSurfaceArea segment by segment
+void benchmarkPipeBillOfMaterials()
+{
+    cout << "Enter number of pipe segments: ";
+    size_t count;
+    cin >> count;
+    if (count == 0) {
+        cout << "Nothing to benchmark." << endl;
+        return;
+    }
+
+    mt19937 rng(50);
+    vector<double> lengths(count), outerDiameters(count), thicknesses(count), volumes(count), surfaces(count);
+    for (size_t i = 0; i < count; ++i) {
+        lengths[i] = 5 + (rng() % 49500) / 100.0;              // 5-500 m
+        outerDiameters[i] = 0.02 + (rng() % 480) / 1000.0;     // 20-500 mm
+        thicknesses[i] = outerDiameters[i] * (0.05 + (rng() % 10) / 100.0);
+    }
+
+    auto start = chrono::steady_clock::now();
+    double scalarVolume = 0, scalarSurface = 0;
+    for (size_t i = 0; i < count; ++i) {
+        scalarVolume += calculatePipeVolume(lengths[i], outerDiameters[i], thicknesses[i]);
+        scalarSurface += calculateSurfaceArea(lengths[i], outerDiameters[i]);
+    }
+    double scalarMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    PipeBillOfMaterials totals = pipeBillOfMaterials(lengths.data(), outerDiameters.data(), thicknesses.data(), count);
+    double batchMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    pipeBillOfMaterials(lengths.data(), outerDiameters.data(), thicknesses.data(), count, volumes.data(), surfaces.data());
+    double perSegmentMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << "\nPipe bill-of-materials benchmark (" << count << " segments, " << totals.length / 1000 << " km)\n";
+    cout << "Scalar functions, segment by segment: " << scalarMs << " ms (" << count / (scalarMs / 1000.0) / 1e6 << "M segments/s)\n";
+    cout << "Batch kernel, totals only:            " << batchMs << " ms (" << count / (batchMs / 1000.0) / 1e6 << "M segments/s)\n";
+    cout << "Batch kernel, with per-segment output: " << perSegmentMs << " ms\n";
+    cout << "Relative difference: volume " << fabs(totals.pipeVolume - scalarVolume) / scalarVolume << ", surface "
+         << fabs(totals.surfaceArea - scalarSurface) / scalarSurface << "\n";
+
+    const pair<const char*, double> pipes[] = {{"steel", 7850}, {"polythene", 950}};
+    const tuple<const char*, double, double> coatings[] = {{"epoxy", 0.005, 1200}, {"polythene", 0.01, 950}, {"plastic", 0.008, 1050}};
+    cout << "Pipe wall: " << totals.pipeVolume << " cubic meters";
+    for (const auto& pipe : pipes)
+        cout << ", " << pipe.first << " " << totals.pipeWeight(pipe.second) << " kg";
+    cout << "\nCoating over " << totals.surfaceArea << " square meters:";
+    for (const auto& coating : coatings)
+        cout << " " << get<0>(coating) << " " << totals.coatingVolume(get<1>(coating)) << " cubic meters / "
+             << totals.coatingWeight(get<1>(coating), get<2>(coating)) << " kg;";
+    cout << endl;
+}
+
+// Function to benchmark aggregations over the columnar mirror against iterating map<string, Customer>
+void benchmarkCustomerColumns()
+{
+    cout << "Enter number of customers to load: ";
+    size_t count;
+    cin >> count;
+
+    const char* supplyTypes[] = {"Regular", "Emergency", "Standard", "Premium"};
+    vector<Customer> batch;
+    batch.reserve(count);
+    map<string, Customer> tree;
+    for (size_t i = 0; i < count; ++i) {
+        Customer c("Customer " + to_string(i), "Street " + to_string(i % 500), "C" + to_string(100000 + i),
+                   "Udyambag", supplyTypes[i % 4], "Monthly", (double)(i % 300), (double)(i % 40000));
+        tree[c.customer_id] = c;
+        batch.push_back(c);
+    }
+    CustomerStore store;
+    store.bulkLoad(batch);
+    const CustomerColumns& cols = store.columns();
+    uint32_t emergency = (uint32_t)store.supplyTypes().find("Emergency");
+
+    auto time = [](function<double()> run, double& result) {
+        auto start = chrono::steady_clock::now();
+        result = run();
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    };
+    double r[6];
+    double mapSum = time([&]() {
+        double total = 0;
+        for (const auto& entry : tree)
+            total += entry.second.total_amount;
+        return total;
+    }, r[0]);
+    double oneThread = time([&]() { return cols.totalAmount(1); }, r[1]);
+    double allThreads = time([&]() { return cols.totalAmount(); }, r[2]);
+    double mapWhere = time([&]() {
+        double total = 0;
+        for (const auto& entry : tree)
+            if (entry.second.supply_type == "Emergency")
+                total += entry.second.total_amount;
+        return total;
+    }, r[3]);
+    double colsWhere = time([&]() { return cols.sumWhere(cols.amount, cols.supplyType, emergency); }, r[4]);
+    double colsAbove = time([&]() { return (double)cols.countAbove(cols.amount, 20000.0); }, r[5]);
+
+    cout << "\nCustomer analytics benchmark (" << count << " customers, "
+         << max(1u, thread::hardware_concurrency()) << " hardware threads)\n";
+    cout << "Sum total_amount, map<string, Customer>: " << mapSum << " ms (" << r[0] << ")\n";
+    cout << "Sum total_amount, columns, 1 thread:     " << oneThread << " ms (" << r[1] << ")\n";
+    cout << "Sum total_amount, columns, all threads:  " << allThreads << " ms (" << r[2] << ")\n";
+    cout << "Sum for Emergency supply, map:           " << mapWhere << " ms (" << r[3] << ")\n";
+    cout << "Sum for Emergency supply, columns:       " << colsWhere << " ms (" << r[4] << ")\n";
+    cout << "Count total_amount > 20000, columns:     " << colsAbove << " ms (" << r[5] << ")" << endl;
+}
 
 
 
-    void display()
-    {
-        cout << "\nPipeline details: Length = " << length << " meters, Diameter = " << diameter
-             << " inches, Material = " << material << ", Flow Rate = " << flow_rate
-             << " L/s, Pressure = " << pressure << " PSI, Status = " << status
-             << ", Maintenance Schedule = " << maintenance_schedule << ", Cost = " << cost
-             << ", Leak Detection Type = " << leak_detection_type << endl;
+// Prototypes used only by the performance benchmarks (3. Routing During Network Edits and 9. Concurrent
+// Customer Store): a network that can be edited while routes are being read, and a customer table for
+// lock-free concurrent readers. No menu path depends on them; the menus use Graph and DurableCustomerStore.
+
+// Class to free objects retired by writers once no reader can still be using them (epoch-based reclamation).
+// Readers pin a slot with the current epoch and never block; writers tag retired objects with the epoch
+// after the swap and free them when every pinned slot has moved past it.
+class EpochReclaimer {
+public:
+    static const int MAX_READERS = 256;
+
+    EpochReclaimer() : globalEpoch(1) {
+        for (int i = 0; i < MAX_READERS; ++i)
+            slots[i].store(0);
     }
 
+    ~EpochReclaimer() {
+        for (auto& r : retired)
+            r.second();
+    }
 
-    void updateMaintenanceSchedule(string newSchedule)
-    {
-        maintenance_schedule = newSchedule;
-        cout << "Maintenance schedule updated to: " << newSchedule << endl;
+    // Pin the calling reader; returns the slot to pass to exit()
+    int enter() {
+        static atomic<unsigned> nextHint(0);
+        thread_local unsigned hint = nextHint.fetch_add(1);
+        for (unsigned i = 0;; ++i) {
+            int slot = (int)((hint + i) % MAX_READERS);
+            uint64_t expected = 0;
+            if (slots[slot].compare_exchange_strong(expected, globalEpoch.load()))
+                return slot;
+        }
+    }
+
+    void exit(int slot) {
+        slots[slot].store(0);
+    }
+
+    // Called by a writer after it has unpublished the object
+    void retire(function<void()> deleter) {
+        lock_guard<mutex> lock(retiredMutex);
+        uint64_t epoch = globalEpoch.fetch_add(1) + 1;
+        retired.push_back(make_pair(epoch, deleter));
+        reclaimLocked();
+    }
 
+    // Free whatever no pinned reader can reach any more
+    void reclaim() {
+        lock_guard<mutex> lock(retiredMutex);
+        reclaimLocked();
     }
 
+    size_t pendingCount() {
+        lock_guard<mutex> lock(retiredMutex);
+        return retired.size();
+    }
 
+private:
+    atomic<uint64_t> globalEpoch;
+    atomic<uint64_t> slots[MAX_READERS];
+    mutex retiredMutex;
+    vector<pair<uint64_t, function<void()>>> retired;
+
+    void reclaimLocked() {
+        uint64_t oldest = UINT64_MAX;
+        for (int i = 0; i < MAX_READERS; ++i) {
+            uint64_t e = slots[i].load();
+            if (e != 0 && e < oldest)
+                oldest = e;
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < retired.size(); ++i) {
+            if (retired[i].first <= oldest)
+                retired[i].second();
+            else
+                retired[kept++] = retired[i];
+        }
+        retired.resize(kept);
+    }
 };
 
-class Customer
+// Number of nodes per copy-on-write adjacency block
+const int ADJACENCY_BLOCK_NODES = 256;
 
-{
-public:
+// Structure to represent one block of adjacency lists; never modified once published
+struct AdjacencyBlock {
+    vector<vector<pair<int, int>>> lists;  // (neighbour id, meters) for each node of the block
+};
 
-    string name;
-    string address;
-    string customer_id;
-    string location; // Customer's location to calculate distance
-    string supply_type; // Regular, Emergency
-    string billing_cycle; // Monthly, Quarterly, Weekly
-    double total_usage; // Total water usage during billing cycle
-    double total_amount; // Total amount to be paid
-    vector<Pipeline> pipelines; // A customer may have multiple pipelines
-    vector<string> usage_history; // History of water usage and billing information
+// Structure to represent one immutable version of the pump station network
+struct GraphVersion {
+    uint64_t version = 0;
+    int nodeCount = 0;
+    shared_ptr<const vector<string>> names;            // node id -> area name
+    shared_ptr<const map<string, int>> ids;            // area name -> node id
+    vector<shared_ptr<const AdjacencyBlock>> blocks;   // shared with the previous version when unchanged
 
+    const vector<pair<int, int>>& neighbors(int u) const {
+        return blocks[u / ADJACENCY_BLOCK_NODES]->lists[u % ADJACENCY_BLOCK_NODES];
+    }
 
-    // Default constructor
-    Customer()
-        : name(""),
-        address(""),
-        customer_id(""),
-        location(""),
-          supply_type("Regular"),
-          billing_cycle("Monthly"),
-          total_usage(0),
-          total_amount(0) {}
+    int idOf(const string& name) const {
+        auto it = ids->find(name);
+        return it == ids->end() ? -1 : it->second;
+    }
 
+    // Same result as Graph::dijkstra, computed on this version only
+    map<string, int> dijkstra(const string& source) const {
+        vector<int> dist(nodeCount, INT_MAX);
+        int s = idOf(source);
+        if (s >= 0) {
+            priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+            dist[s] = 0;
+            pq.push(make_pair(0, s));
+            while (!pq.empty()) {
+                int du = pq.top().first;
+                int u = pq.top().second;
+                pq.pop();
+                if (du > dist[u])
+                    continue;
+                for (const auto& e : neighbors(u)) {
+                    if (du + e.second < dist[e.first]) {
+                        dist[e.first] = du + e.second;
+                        pq.push(make_pair(dist[e.first], e.first));
+                    }
+                }
+            }
+        }
+        map<string, int> result;
+        for (int u = 0; u < nodeCount; ++u)
+            result[(*names)[u]] = dist[u];
+        return result;
+    }
+};
 
-    // Parameterized constructor
-    Customer(string n, string addr, string id, string loc, string supply, string cycle, double usage, double amount)
-        : name(n),
-        address(addr),
-        customer_id(id),
-        location(loc),
-        supply_type(supply),
-        billing_cycle(cycle),
-          total_usage(usage),
-          total_amount(amount) {}
+// Class to serve routing queries from immutable network versions while edits build the next one.
+// Readers pin the current version without locking; an edit copies only the adjacency blocks it touches.
+class VersionedGraph {
+public:
+    // Reader handle; the version stays alive until the snapshot is destroyed
+    class Snapshot {
+    public:
+        Snapshot(EpochReclaimer& r, const atomic<const GraphVersion*>& current) : reclaimer(&r) {
+            slot = reclaimer->enter();
+            version = current.load();
+        }
+        Snapshot(Snapshot&& other) : reclaimer(other.reclaimer), slot(other.slot), version(other.version) {
+            other.reclaimer = NULL;
+        }
+        ~Snapshot() {
+            if (reclaimer)
+                reclaimer->exit(slot);
+        }
+        const GraphVersion* operator->() const {
+            return version;
+        }
+        const GraphVersion& operator*() const {
+            return *version;
+        }
 
+    private:
+        EpochReclaimer* reclaimer;
+        int slot;
+        const GraphVersion* version;
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+    };
 
-    void display()
-    {
-        cout << "\nCustomer Details: \nName: " << name << "\nAddress: " << address
-             << "\nCustomer ID: " << customer_id << "\nLocation: " << location
-             << "\nSupply Type: " << supply_type << "\nBilling Cycle: " << billing_cycle
-             << "\nTotal Water Usage: " << total_usage << "\nTotal Amount: " << total_amount << endl;
+    // Writer handle collecting several changes into one new version
+    class Editor {
+    public:
+        Editor(VersionedGraph& owner) : graph(owner), lock(owner.writerMutex) {
+            const GraphVersion* base = graph.current.load();
+            next = new GraphVersion(*base);
+            next->version = base->version + 1;
+        }
+        ~Editor() {
+            delete next;  // not committed
+        }
 
-        cout << "\nPipeline Details: " << endl;
-        for (auto &pipe : pipelines)
-        {
-            pipe.display();
+        void addEdge(const string& u, const string& v, int distance) {
+            int a = nodeId(u), b = nodeId(v);
+            list(a).push_back(make_pair(b, distance));
+            list(b).push_back(make_pair(a, distance));
         }
 
-        cout << "\nUsage History: " << endl;
-        for (const string &record : usage_history)
-        {
-            cout << record << endl;
+        // Disconnects every pipeline between u and v; returns false if there was none
+        bool removeEdge(const string& u, const string& v) {
+            int a = next->idOf(u), b = next->idOf(v);
+            if (a < 0 || b < 0)
+                return false;
+            bool removed = eraseNeighbor(a, b);
+            eraseNeighbor(b, a);
+            return removed;
         }
-    }
 
+        void commit() {
+            graph.publish(next);
+            next = NULL;
+        }
 
+    private:
+        VersionedGraph& graph;
+        lock_guard<mutex> lock;
+        GraphVersion* next;
+        map<int, AdjacencyBlock*> copied;  // blocks already copied in this edit
+        vector<string>* newNames = NULL;
+        map<string, int>* newIds = NULL;
+
+        int nodeId(const string& name) {
+            int id = next->idOf(name);
+            if (id >= 0)
+                return id;
+            if (!newNames) {
+                auto names = make_shared<vector<string>>(*next->names);
+                auto ids = make_shared<map<string, int>>(*next->ids);
+                newNames = names.get();
+                newIds = ids.get();
+                next->names = names;
+                next->ids = ids;
+            }
+            id = next->nodeCount++;
+            newNames->push_back(name);
+            (*newIds)[name] = id;
+            if (id % ADJACENCY_BLOCK_NODES == 0)
+                next->blocks.push_back(make_shared<AdjacencyBlock>());
+            block(id / ADJACENCY_BLOCK_NODES)->lists.push_back(vector<pair<int, int>>());
+            return id;
+        }
 
-    void addPipeline(Pipeline p)
-    {
-        pipelines.push_back(p);
-        cout << "New pipeline added for " << name << endl;
-    }
+        AdjacencyBlock* block(int b) {
+            auto it = copied.find(b);
+            if (it != copied.end())
+                return it->second;
+            auto fresh = make_shared<AdjacencyBlock>(*next->blocks[b]);
+            next->blocks[b] = fresh;
+            copied[b] = fresh.get();
+            return fresh.get();
+        }
 
+        vector<pair<int, int>>& list(int u) {
+            return block(u / ADJACENCY_BLOCK_NODES)->lists[u % ADJACENCY_BLOCK_NODES];
+        }
 
+        bool eraseNeighbor(int u, int v) {
+            const auto& current = next->neighbors(u);
+            bool present = false;
+            for (const auto& e : current)
+                if (e.first == v)
+                    present = true;
+            if (!present)
+                return false;
+            auto& edges = list(u);
+            edges.erase(remove_if(edges.begin(), edges.end(),
+                                  [v](const pair<int, int>& e) { return e.first == v; }),
+                        edges.end());
+            return true;
+        }
+    };
 
-    void addUsageRecord(string record)
-    {
-        usage_history.push_back(record);
-        cout << "Usage record added: " << record << endl;
+    VersionedGraph(const Graph& g) {
+        GraphVersion* first = new GraphVersion();
+        auto names = make_shared<vector<string>>();
+        auto ids = make_shared<map<string, int>>();
+        for (const auto& node : g.adj) {
+            (*ids)[node.first] = (int)names->size();
+            names->push_back(node.first);
+        }
+        first->nodeCount = (int)names->size();
+        shared_ptr<AdjacencyBlock> block;
+        for (const auto& node : g.adj) {
+            if (!block || (int)block->lists.size() == ADJACENCY_BLOCK_NODES) {
+                block = make_shared<AdjacencyBlock>();
+                first->blocks.push_back(block);
+            }
+            vector<pair<int, int>> edges;
+            for (const auto& neighbor : node.second)
+                edges.push_back(make_pair((*ids)[neighbor.first], neighbor.second));
+            block->lists.push_back(edges);
+        }
+        first->names = names;
+        first->ids = ids;
+        current.store(first);
     }
 
+    ~VersionedGraph() {
+        reclaimer.reclaim();
+        delete current.load();
+    }
 
-};
-
-class Graph
+    Snapshot pin() {
+        return Snapshot(reclaimer, current);
+    }
 
-{
-public:
+    void addEdge(const string& u, const string& v, int distance) {
+        Editor edit(*this);
+        edit.addEdge(u, v, distance);
+        edit.commit();
+    }
 
-    map<string, vector<pair<string, int>>> adj;
+    bool removeEdge(const string& u, const string& v) {
+        Editor edit(*this);
+        bool removed = edit.removeEdge(u, v);
+        if (removed)
+            edit.commit();
+        return removed;
+    }
 
-    void addEdge(string u, string v, int distance)
-    {
-        adj[u].push_back(make_pair(v, distance));
-        adj[v].push_back(make_pair(u, distance));
+    size_t versionsAwaitingReclaim() {
+        return reclaimer.pendingCount();
     }
 
+private:
+    atomic<const GraphVersion*> current;
+    mutex writerMutex;
+    EpochReclaimer reclaimer;
 
-    map<string, int> dijkstra(string source)
-    {
-        map<string, int> dist;
-        for (auto &node : adj)
-        {
-            dist[node.first] = INT_MAX;
-        }
-        dist[source] = 0;
+    void publish(GraphVersion* next) {
+        const GraphVersion* old = current.exchange(next);
+        reclaimer.retire([old]() { delete old; });
+    }
 
-        priority_queue<pair<int, string>, vector<pair<int, string>>, greater<pair<int, string>>> pq;
-        pq.push(make_pair(0, source));
+    VersionedGraph(const VersionedGraph&) = delete;
+    VersionedGraph& operator=(const VersionedGraph&) = delete;
+};
 
+// Function to benchmark routing queries running while the network is being edited
+void benchmarkVersionedGraph(Graph& g)
+{
+    VersionedGraph versions(g);
+    const int readers = 4;
+    atomic<bool> stop(false);
+    atomic<long long> queries(0);
+    vector<string> areas;
+    for (const auto& node : g.adj)
+        areas.push_back(node.first);
+
+    vector<thread> threads;
+    for (int r = 0; r < readers; ++r) {
+        threads.push_back(thread([&, r]() {
+            size_t next = r;
+            while (!stop.load()) {
+                VersionedGraph::Snapshot snapshot = versions.pin();
+                snapshot->dijkstra(areas[next % areas.size()]);
+                next += readers;
+                queries.fetch_add(1);
+            }
+        }));
+    }
 
-        while (!pq.empty())
-        {
-            int u_dist = pq.top().first;
-            string u = pq.top().second;
-            pq.pop();
+    auto start = chrono::steady_clock::now();
+    int edits = 0;
+    while (chrono::steady_clock::now() - start < chrono::seconds(2)) {
+        // Lay a new main and then disconnect it again
+        string from = areas[edits % areas.size()];
+        string to = areas[(edits * 7 + 3) % areas.size()];
+        versions.addEdge(from, to, 100 + edits % 900);
+        versions.removeEdge(from, to);
+        edits += 2;
+    }
+    stop.store(true);
+    for (auto& t : threads)
+        t.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "\nVersioned graph benchmark (" << readers << " reader threads, 1 writer)\n";
+    cout << "Edits published: " << edits << " (" << edits / seconds << " per second)\n";
+    cout << "Queries answered during edits: " << queries.load() << " (" << queries.load() / seconds << " per second)\n";
+    cout << "Versions still awaiting reclaim: " << versions.versionsAwaitingReclaim() << endl;
+}
 
-            if (u_dist > dist[u])
-                continue;
+// Class to share the customer table between many concurrent readers and writers.
+// Customers are split into shards by a hash of their parsed ID, and each shard has its own writer lock.
+// Readers take no lock: a published record is never modified; an update publishes a new record, and
+// the replaced one is freed through an EpochReclaimer once no reader can still be looking at it.
+class ConcurrentCustomerStore {
+public:
+    static const int SHARD_BITS = 6;
+    static const int SHARDS = 1 << SHARD_BITS;
 
-            for (auto &neighbor : adj[u])
-            {
-                string v = neighbor.first;
-                int weight = neighbor.second;
+    ConcurrentCustomerStore() : count(0) {
+        for (Shard& shard : shards)
+            shard.table.store(new Table(16));
+    }
 
-                if (dist[u] + weight < dist[v])
-                {
-                    dist[v] = dist[u] + weight;
-                    pq.push(make_pair(dist[v], v));
+    ~ConcurrentCustomerStore() {
+        for (Shard& shard : shards) {
+            Table* table = shard.table.load();
+            for (size_t b = 0; b <= table->mask; ++b) {
+                for (Node* n = table->heads[b].load(); n;) {
+                    Node* next = n->next.load();
+                    delete n->customer;
+                    delete n;
+                    n = next;
                 }
             }
+            delete table;
+            freeGarbage(shard.garbage);
         }
-        return dist;
     }
 
+    // Returns true if the customer is new, false if an existing one was replaced
+    bool put(const Customer& c) {
+        uint64_t key = parseCustomerKey(c.customer_id);
+        size_t hash = spread(key);
+        Shard& shard = shards[hash >> (64 - SHARD_BITS)];
+        lock_guard<mutex> lock(shard.writer);
+        Table* table = shard.table.load(memory_order_relaxed);
+        atomic<Node*>* link = &table->heads[hash & table->mask];
+        for (Node* n = link->load(memory_order_relaxed); n; n = n->next.load(memory_order_relaxed)) {
+            if (matches(n, key, c.customer_id)) {
+                link->store(new Node(key, new Customer(c), n->next.load(memory_order_relaxed)), memory_order_release);
+                discard(shard, n, n->customer);
+                return false;
+            }
+            link = &n->next;
+        }
+        atomic<Node*>& head = table->heads[hash & table->mask];
+        head.store(new Node(key, new Customer(c), head.load(memory_order_relaxed)), memory_order_release);
+        count.fetch_add(1, memory_order_relaxed);
+        if (++shard.size > table->mask + 1)
+            grow(shard);
+        return true;
+    }
 
+    bool erase(const string& id) {
+        uint64_t key = parseCustomerKey(id);
+        size_t hash = spread(key);
+        Shard& shard = shards[hash >> (64 - SHARD_BITS)];
+        lock_guard<mutex> lock(shard.writer);
+        Table* table = shard.table.load(memory_order_relaxed);
+        atomic<Node*>* link = &table->heads[hash & table->mask];
+        for (Node* n = link->load(memory_order_relaxed); n; n = n->next.load(memory_order_relaxed)) {
+            if (matches(n, key, id)) {
+                link->store(n->next.load(memory_order_relaxed), memory_order_release);
+                discard(shard, n, n->customer);
+                shard.size--;
+                count.fetch_sub(1, memory_order_relaxed);
+                return true;
+            }
+            link = &n->next;
+        }
+        return false;
+    }
 
-    int getShortestDistanceToPumpStation(string customerLocation)
-    {
-        map<string, int> distances = dijkstra(customerLocation);
-
-        int minDistance = INT_MAX;
-
-        for (auto &d : distances)
-        {
-            if (d.first != customerLocation && d.second < minDistance)
-            {
-                minDistance = d.second;
+    // Call visit(const Customer&) on the customer, if present, without taking any lock
+    template <typename Visit>
+    bool read(const string& id, Visit visit) const {
+        uint64_t key = parseCustomerKey(id);
+        size_t hash = spread(key);
+        const Shard& shard = shards[hash >> (64 - SHARD_BITS)];
+        int slot = reclaimer.enter();
+        const Table* table = shard.table.load(memory_order_acquire);
+        bool found = false;
+        for (const Node* n = table->heads[hash & table->mask].load(memory_order_acquire); n;
+             n = n->next.load(memory_order_acquire)) {
+            if (matches(n, key, id)) {
+                visit(*n->customer);
+                found = true;
+                break;
             }
         }
-        return (minDistance == INT_MAX) ? -1 : minDistance;
+        reclaimer.exit(slot);
+        return found;
     }
 
+    // Copy of the customer, if present
+    bool get(const string& id, Customer& out) const {
+        return read(id, [&out](const Customer& c) { out = c; });
+    }
 
-};
+    size_t size() const {
+        return count.load(memory_order_relaxed);
+    }
 
-void displayMenu()
+private:
+    static const size_t GARBAGE_BATCH = 64;
 
-{
-    cout << "\n\nWelcome to the Belagavi City Water Corporation\n";
-    cout << "Please choose an option:\n";
-    cout << "0. Create New Customer\n";
-    cout << "1. Choose Material Type of Pipe\n";
-    cout << "2. Choose Billing Type\n";
-    cout << "3. Choose Leak Detection Type\n";
-    cout << "4. Choose Supply Type\n";
-    cout << "5. View Pipeline Details\n";
-    cout << "6. View Customer Details\n";
-    cout << "7. Finalize Selections\n";
-    cout << "8. View Total Installation Cost\n";
-    cout << "9. Update Maintenance Schedule\n";
-    cout << "10. Add New Pipeline\n";
-    cout << "11. Customer Details (Already Installed Pipeline)\n";
-    cout << "12. Disconnect Pipeline (Already Installed Pipeline)\n";
-    cout << "13. Exit\n";
+    struct Node {
+        uint64_t key;
+        const Customer* customer;
+        atomic<Node*> next;
 
+        Node(uint64_t k, const Customer* c, Node* n) : key(k), customer(c), next(n) {}
+    };
 
-}
+    struct Table {
+        size_t mask;
+        unique_ptr<atomic<Node*>[]> heads;
 
-// Structure to represent the AreaDetails with distance and cost
-struct AreaDetails {
-    string area_name;
-    int distance; // distance from selected area (in meters)
-    int cost;     // cost in Rs
-};
+        explicit Table(size_t buckets) : mask(buckets - 1), heads(new atomic<Node*>[buckets]) {
+            for (size_t b = 0; b < buckets; ++b)
+                heads[b].store(NULL, memory_order_relaxed);
+        }
+    };
 
-// Structure to represent the Sub-division gas pipeline Office
-struct Sub_division_gas_pipeline_office {
-    vector<AreaDetails> areas;  // List of areas in the sub-division
-};
+    // Structure to hold what a writer has unpublished but not yet handed to the reclaimer
+    struct Garbage {
+        vector<Node*> nodes;
+        vector<const Customer*> customers;
+        vector<Table*> tables;
+    };
 
-// Function to implement the functionality of displaying areas based on the selected zone
-void displayAreas(const string& selected_zone, const unordered_map<string, vector<string>>& zone_areas)
-{
-    cout << selected_zone << " contains the following areas:\n";
-    const vector<string>& areas = zone_areas.at(selected_zone);  // Get areas for selected zone
-    for (size_t i = 0; i < areas.size(); ++i) {
-        cout << i + 1 << ". " << areas[i] << endl;  // Display area number and name
+    struct alignas(64) Shard {
+        mutex writer;
+        atomic<Table*> table;
+        size_t size = 0;
+        Garbage garbage;
+    };
+
+    Shard shards[SHARDS];
+    mutable EpochReclaimer reclaimer;
+    atomic<size_t> count;
+
+    static size_t spread(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return (size_t)key;
     }
-}
 
-// Function to display the sub-division office and area details based on the selected area
-void displaySubDivisionDetails(const string& selected_area, const unordered_map<string, Sub_division_gas_pipeline_office>& area_details) {
-    auto it = area_details.find(selected_area);  // Find the selected area in the area details map
-    if (it != area_details.end()) {
-        // Correctly displaying the area name dynamically
-        cout << "gas pipeline office " << selected_area << ":\n";
-        for (size_t i = 0; i < it->second.areas.size(); ++i) {
-            const AreaDetails& area = it->second.areas[i];
-            cout << i + 1 << ". " << area.area_name << " - " << area.distance << " meters, cost - " << area.cost << " rs\n";
-        }
-    } else {
-        cout << "Area not found in this sub-division.\n";
+    // Packed keys are exact; hashed ones (top bit set) are confirmed against the ID
+    static bool matches(const Node* n, uint64_t key, const string& id) {
+        return n->key == key && ((key >> 63) == 0 || n->customer->customer_id == id);
     }
-}
 
-// Function to find the area with the shortest distance
-string findShortestDistanceArea(const vector<AreaDetails>& areas) {
-    // Find the area with the minimum distance
-    auto min_it = min_element(areas.begin(), areas.end(), [](const AreaDetails& a, const AreaDetails& b) {
-        return a.distance < b.distance;
-    });
-    return min_it->area_name;
-}
+    static void freeGarbage(Garbage& garbage) {
+        for (Node* n : garbage.nodes)
+            delete n;
+        for (const Customer* c : garbage.customers)
+            delete c;
+        for (Table* t : garbage.tables)
+            delete t;
+        garbage = Garbage();
+    }
 
-// Function to calculate the volume of a cylindrical pipe
-double calculatePipeVolume(double length, double outerDiameter, double thickness)
-{
-    const double PI = 3.14159265359;
-    double innerDiameter = outerDiameter - 2 * thickness;
-    double outerRadius = outerDiameter / 2.0;
-    double innerRadius = innerDiameter / 2.0;
+    // Called with the shard lock held; customer may be NULL when the node's customer lives on
+    void discard(Shard& shard, Node* node, const Customer* customer) {
+        shard.garbage.nodes.push_back(node);
+        if (customer)
+            shard.garbage.customers.push_back(customer);
+        if (shard.garbage.nodes.size() >= GARBAGE_BATCH)
+            retireGarbage(shard);
+    }
 
-    double outerVolume = PI * outerRadius * outerRadius * length;
-    double innerVolume = PI * innerRadius * innerRadius * length;
+    void retireGarbage(Shard& shard) {
+        shared_ptr<Garbage> batch = make_shared<Garbage>();
+        swap(*batch, shard.garbage);
+        reclaimer.retire([batch]() { freeGarbage(*batch); });
+    }
 
-    return outerVolume - innerVolume; // Material volume
-}
-// Function to calculate the surface area of a cylindrical pipe
-double calculateSurfaceArea(double length, double outerDiameter)
+    // Called with the shard lock held: rebuild the shard at twice the buckets. The customers
+    // move over as they are; the old nodes and table are retired once readers are done with them.
+    void grow(Shard& shard) {
+        Table* old = shard.table.load(memory_order_relaxed);
+        Table* bigger = new Table((old->mask + 1) * 2);
+        for (size_t b = 0; b <= old->mask; ++b) {
+            for (Node* n = old->heads[b].load(memory_order_relaxed); n; n = n->next.load(memory_order_relaxed)) {
+                atomic<Node*>& head = bigger->heads[spread(n->key) & bigger->mask];
+                head.store(new Node(n->key, n->customer, head.load(memory_order_relaxed)), memory_order_relaxed);
+                shard.garbage.nodes.push_back(n);
+            }
+        }
+        shard.table.store(bigger, memory_order_release);
+        shard.garbage.tables.push_back(old);
+        retireGarbage(shard);
+    }
+};
+
+// Function to stress the concurrent customer store with mixed reads and writes at 1 to 64 threads,
+// next to a CustomerStore behind one mutex
+void benchmarkConcurrentStore()
 {
-    const double PI = 3.14159265359;
-    double radius = outerDiameter / 2.0;
-    return 2 * PI * radius * length; // Surface area of the cylindrical surface
-}
+    cout << "Enter number of customers to load: ";
+    int count;
+    cin >> count;
+    cout << "Enter percentage of writes (0-100): ";
+    int writePercent;
+    cin >> writePercent;
+    if (count <= 0 || writePercent < 0 || writePercent > 100) {
+        cout << "Nothing to benchmark." << endl;
+        return;
+    }
 
-// Function to categorize pressure
-string categorizePressure(double pressure)
- {
-    if (pressure > 100)
-    {
-        return "High Pressure";
-    } else if (pressure >= 40 && pressure <= 100)
-    {
-        return "Medium Pressure";
-    } else
-    {
-        return "Low Pressure";
+    vector<Customer> customers;
+    for (int i = 0; i < count; ++i)
+        customers.push_back(Customer("Customer " + to_string(i), "Street " + to_string(i % 500), "C" + to_string(100000 + i),
+                                     "Udyambag", "Regular", "Monthly", (double)(i % 300), (double)(i % 40000)));
+    ConcurrentCustomerStore concurrent;
+    CustomerStore locked;
+    mutex storeLock;
+    for (const Customer& c : customers) {
+        concurrent.put(c);
+        locked.insert(c);
     }
+
+    // Run the workload on the given number of threads for a fixed time; returns (reads/s, writes/s)
+    const chrono::milliseconds duration(250);
+    auto run = [&](int threads, bool useConcurrent) {
+        atomic<bool> stop(false);
+        atomic<uint64_t> reads(0), writes(0);
+        vector<thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.push_back(thread([&, t]() {
+                mt19937 rng(t + 1);
+                uint64_t myReads = 0, myWrites = 0;
+                double seen = 0;
+                while (!stop.load(memory_order_relaxed)) {
+                    const Customer& c = customers[rng() % customers.size()];
+                    if ((int)(rng() % 100) < writePercent) {
+                        Customer updated = c;
+                        updated.total_amount += 1;
+                        if (useConcurrent) {
+                            concurrent.put(updated);
+                        } else {
+                            lock_guard<mutex> lock(storeLock);
+                            locked.insert(updated);
+                        }
+                        myWrites++;
+                    } else {
+                        if (useConcurrent) {
+                            concurrent.read(c.customer_id, [&seen](const Customer& found) { seen += found.total_amount; });
+                        } else {
+                            lock_guard<mutex> lock(storeLock);
+                            const Customer* found = locked.find(c.customer_id);
+                            if (found)
+                                seen += found->total_amount;
+                        }
+                        myReads++;
+                    }
+                }
+                reads += myReads + (seen < 0 ? 1 : 0);
+                writes += myWrites;
+            }));
+        }
+        this_thread::sleep_for(duration);
+        stop = true;
+        for (thread& worker : workers)
+            worker.join();
+        double seconds = chrono::duration<double>(duration).count();
+        return make_pair(reads.load() / seconds, writes.load() / seconds);
+    };
+
+    cout << "\nConcurrent customer store stress (" << count << " customers, " << writePercent << "% writes, "
+         << max(1u, thread::hardware_concurrency()) << " hardware threads)\n";
+    cout << "Threads   Sharded reads/s   Sharded writes/s   Mutex reads/s   Mutex writes/s\n";
+    for (int threads = 1; threads <= 64; threads *= 2) {
+        pair<double, double> sharded = run(threads, true);
+        pair<double, double> mutexed = run(threads, false);
+        cout << threads << "\t  " << (uint64_t)sharded.first << "\t    " << (uint64_t)sharded.second << "\t\t "
+             << (uint64_t)mutexed.first << "\t  " << (uint64_t)mutexed.second << "\n";
+    }
+    cout << "Customers after the run: " << concurrent.size() << endl;
 }
 
 
@@ -321,47 +7622,60 @@ string categorizePressure(double pressure)
 int main()
 
 {
-    map<string, Customer> customerDatabase;
+    // Customers persist across runs in customers.snapshot / customers.wal; the list below only seeds a new store
+    DurableCustomerStore durableCustomers;
+    if (!durableCustomers.open("customers"))
+    {
+        cout << "Saved customer records could not be loaded." << endl;
+    }
+    const CustomerStore& customerDatabase = durableCustomers.customers();
+
+    if (customerDatabase.size() == 0)
+    {
+        vector<Customer> seedCustomers;
+
+        seedCustomers.push_back(Customer("John Doe", "123 Main St", "C0101", "Shaniwar Khoot", "Regular", "Monthly", 100, 2500));
 
-    customerDatabase["C0101"] = Customer("John Doe", "123 Main St", "C0101", "Shaniwar Khoot", "Regular", "Monthly", 100, 2500);
+        seedCustomers.push_back(Customer("Jane Smith", "456 Elm St", "C0102", "Khade Bazar", "Emergency", "Weekly", 200, 6000));
 
-    customerDatabase["C0102"] = Customer("Jane Smith", "456 Elm St", "C0102", "Khade Bazar", "Emergency", "Weekly", 200, 6000);
+        seedCustomers.push_back(Customer("Alice Brown", "789 Pine St", "C0103", "Green Taj", "Regular", "Weekly", 150.0, 8000.0));
 
-    customerDatabase["C0103"] = Customer("Alice Brown", "789 Pine St", "C0103", "Green Taj", "Regular", "Weekly", 150.0, 8000.0);
+        seedCustomers.push_back(Customer("Emily Davis", "101 Oak St", "C0104", "Budhwar Peth", "Regular", "Monthly", 50.0, 20000.0));
 
-    customerDatabase["C0104"] = Customer("Emily Davis", "101 Oak St", "C0104", "Budhwar Peth", "Regular", "Monthly", 50.0, 20000.0);
+        seedCustomers.push_back(Customer("Michael Brown", "202 Maple St", "C0105", "Angol", "Standard", "Quarterly", 75.0, 28000.0));
 
-    customerDatabase["C0105"] = Customer("Michael Brown", "202 Maple St", "C0105", "Angol", "Standard", "Quarterly", 75.0, 28000.0);
+        seedCustomers.push_back(Customer("Sophia White", "303 Cedar St", "C0106", "Ramdev", "Premium", "Monthly", 0.0, 35000.0));
 
-    customerDatabase["C0106"] = Customer("Sophia White", "303 Cedar St", "C0106", "Ramdev", "Premium", "Monthly", 0.0, 35000.0);
+        seedCustomers.push_back(Customer("William Green", "404 Birch St", "C0107", "Mangalwar Peth", "Regular", "Quarterly", 50.0, 27000.0));
 
-    customerDatabase["C0107"] = Customer("William Green", "404 Birch St", "C0107", "Mangalwar Peth", "Regular", "Quarterly", 50.0, 27000.0);
+        seedCustomers.push_back(Customer("Olivia Black", "505 Ash St", "C0108", "Udyambag", "Premium", "Monthly", 100.0, 25000.0));
 
-    customerDatabase["C0108"] = Customer("Olivia Black", "505 Ash St", "C0108", "Udyambag", "Premium", "Monthly", 100.0, 25000.0);
+        seedCustomers.push_back(Customer("Ethan Harris", "606 Willow St", "C0109", "Tilakwadi", "Standard", "Monthly", 200.0, 35000.0));
 
-    customerDatabase["C0109"] = Customer("Ethan Harris", "606 Willow St", "C0109", "Tilakwadi", "Standard", "Monthly", 200.0, 35000.0);
+        seedCustomers.push_back(Customer("Ava Martinez", "707 Cherry St", "C0110", "Bhagya Nagar", "Regular", "Quarterly", 150.0, 3300.0));
 
-    customerDatabase["C0110"] = Customer("Ava Martinez", "707 Cherry St", "C0110", "Bhagya Nagar", "Regular", "Quarterly", 150.0, 3300.0);
+        seedCustomers.push_back(Customer("Carlos Lee", "808 Rose St", "C0111", "Tilakwadi", "Regular", "Monthly", 90.0, 2700.0));
 
-    customerDatabase["C0111"] = Customer("Carlos Lee", "808 Rose St", "C0111", "Tilakwadi", "Regular", "Monthly", 90.0, 2700.0);
+        seedCustomers.push_back(Customer("Mia Williams", "909 Lily St", "C0112", "Udyambag", "Premium", "Monthly", 0.0, 3800.0));
 
-    customerDatabase["C0112"] = Customer("Mia Williams", "909 Lily St", "C0112", "Udyambag", "Premium", "Monthly", 0.0, 3800.0);
+        seedCustomers.push_back(Customer("David Brown", "1001 Maple Ave", "C0113", "Udyambag", "Standard", "Quarterly", 50.0, 2500.0));
 
-    customerDatabase["C0113"] = Customer("David Brown", "1001 Maple Ave", "C0113", "Udyambag", "Standard", "Quarterly", 50.0, 2500.0);
+        seedCustomers.push_back(Customer("Isabella Clark", "1202 Elm St", "C0114", "Tilakwadi", "Regular", "Monthly", 100.0, 2300.0));
 
-    customerDatabase["C0114"] = Customer("Isabella Clark", "1202 Elm St", "C0114", "Tilakwadi", "Regular", "Monthly", 100.0, 2300.0);
+        seedCustomers.push_back(Customer("Ethan Thomas", "1303 Cedar St", "C0115", "Udyambag", "Premium", "Monthly", 0.0, 3900.0));
 
-    customerDatabase["C0115"] = Customer("Ethan Thomas", "1303 Cedar St", "C0115", "Udyambag", "Premium", "Monthly", 0.0, 3900.0);
+        seedCustomers.push_back(Customer("Oliver Anderson", "1404 Pine St", "C0116", "Udyambag", "Regular", "Quarterly", 100.0, 3100.0));
 
-    customerDatabase["C0116"] = Customer("Oliver Anderson", "1404 Pine St", "C0116", "Udyambag", "Regular", "Quarterly", 100.0, 3100.0);
+        seedCustomers.push_back(Customer("Ava Moore", "1505 Oak St", "C0117", "Udyambag", "Premium", "Monthly", 0.0, 3800.0));
 
-    customerDatabase["C0117"] = Customer("Ava Moore", "1505 Oak St", "C0117", "Udyambag", "Premium", "Monthly", 0.0, 3800.0);
+        seedCustomers.push_back(Customer("Lucas Harris", "1606 Birch St", "C0118", "Udyambag", "Regular", "Quarterly", 50.0, 2900.0));
 
-    customerDatabase["C0118"] = Customer("Lucas Harris", "1606 Birch St", "C0118", "Udyambag", "Regular", "Quarterly", 50.0, 2900.0);
+        seedCustomers.push_back(Customer("Charlotte Lee", "1707 Willow St", "C0119", "Udyambag", "Premium", "Monthly", 0.0, 3600.0));
 
-    customerDatabase["C0119"] = Customer("Charlotte Lee", "1707 Willow St", "C0119", "Udyambag", "Premium", "Monthly", 0.0, 3600.0);
+        seedCustomers.push_back(Customer("James Davis", "1808 Cherry St", "C0120", "Tilakwadi", "Regular", "Monthly", 90.0, 2800.0));
 
-    customerDatabase["C0120"] = Customer("James Davis", "1808 Cherry St", "C0120", "Tilakwadi", "Regular", "Monthly", 90.0, 2800.0);
+        durableCustomers.putBatch(seedCustomers);
+    }
 
 
     //The location distances to pump stations
@@ -518,10 +7832,10 @@ int main()
     // Declare variables
 
     string name, address, customerID, location;
-    string pipeMaterial;
-    string billingCycle;
-    string leakDetectionType;
-    string supplyType;
+    PipeMaterial pipeMaterial;
+    BillingCycle billingCycle;
+    LeakDetectionType leakDetectionType;
+    SupplyType supplyType;
 
     bool materialSelected = false;
     bool billingSelected = false;
@@ -532,16 +7846,45 @@ int main()
     Customer customer;
     // Initialize customer object
 
-    map<string, string> leakDetectionOptions = {{"1", "Ultrasonic"}, {"2", "Pressure Differential"}};
+    map<string, string> leakDetectionOptions = {{"1", "Ultrasonic"}, {"2", "Pressure Differential"}};
+
+    MaterialRateTable materialRates = {{"Steel", 900.0}, {"PVC", 400.0}, {"Concrete", 650.0}};
+
+    // Starts as the compiled-in tariff; option 19 reloads it from a file
+    ReloadableSupplyPricing supplyPricing(waterSupplyTariff);
+
+    // Metered usage is billed by slab if tariffs.cfg has a [water] section, otherwise at total_amount
+    SlabTariff waterSlabs;
+    bool haveWaterSlabs = SlabTariff::load(SLAB_TARIFF_CONFIG, "water", waterSlabs);
 
-    map<string, double> materialRates = {{"Steel", 900.0}, {"PVC", 400.0}, {"Concrete", 650.0}};
+    // Prices installations along the actual route to the nearest pump station
+    RouteCostEngine<Graph, MaterialRateTable, ReloadableSupplyPricing> costEngine(g, materialRates, supplyPricing);
 
-    map<string, map<string, double>> supplyPricing =
+    // Pump stations and the ground along each segment, from network.cfg
+    NetworkConditions waterNetwork;
+    if (NetworkConditions::load(NETWORK_CONFIG, "water", waterNetwork))
     {
-        {"Regular", {{"Monthly", 100.0}, {"Quarterly", 250.0}, {"Weekly", 25.0}}},
+        size_t unknown = costEngine.configure(waterNetwork);
+        if (unknown > 0)
+        {
+            cout << "Warning: " << unknown << " station(s) / segment(s) in " << NETWORK_CONFIG << " [water] are not in the network." << endl;
+        }
+    }
+    else
+    {
+        cout << "Note: no [water] section in " << NETWORK_CONFIG << "; quotes route to the closest node on flat ground." << endl;
+    }
 
-        {"Emergency", {{"Monthly", 200.0}, {"Quarterly", 500.0}, {"Weekly", 50.0}}}
-    };
+#ifndef _WIN32
+    // The shard processes of option 21 are forked here, while this is the only thread: a child forked
+    // after the compactor starts could inherit a lock that thread holds
+    unique_ptr<ShardedRouter> shardedRouter(new ShardedRouter(g, 2));
+#endif
+
+    // Disconnected customers stay visible in case 11 for 30 days, then are reclaimed in the background.
+    // Started only now: until here customerDatabase is read without the store lock, and no process is
+    // forked after it.
+    durableCustomers.startCompactor(30 * 24 * 3600);
 
     bool exitMenu = false;
 
@@ -701,9 +8044,9 @@ int main()
                     continue;
                 }
                 supplyTypeSelected = true;
-                if (supplyPricing.count(supplyType) && supplyPricing[supplyType].count(billingCycle))
+                if (supplyPricing.has(supplyType, billingCycle))
                     {
-                    double supplyCost = supplyPricing[supplyType][billingCycle];
+                    Money supplyCost = supplyPricing.at(supplyType, billingCycle);
                     cout << "You selected " << supplyType << " as the supply type." << endl;
                     cout << "The cost for " << supplyType << " supply with " << billingCycle << " billing is: " << supplyCost << " currency." << endl;
                     break;
@@ -734,13 +8077,25 @@ int main()
 
                 if (billingSelected && materialSelected && leakDetectionSelected && supplyTypeSelected)
                     {
-                    double materialCost = materialRates[pipeMaterial];
-                    double supplyCost = supplyPricing[supplyType][billingCycle];
-                    double totalInstallCost = materialCost * pipeline.length + supplyCost;
-                    customer.total_amount = totalInstallCost;
+                    const InstallationQuote& quote = costEngine.quote(customer.location, pipeMaterial, supplyType, billingCycle);
+                    if (quote.routeFound)
+                    {
+                        customer.total_amount = quote.total.rupees();
+                    }
+                    else
+                    {
+                        // Location is not on the network: fall back to the flat rate per meter
+                        Money materialCost = materialRates.at(pipeMaterial);
+                        Money supplyCost = supplyPricing.at(supplyType, billingCycle);
+                        customer.total_amount = (materialCost.times(pipeline.length) + supplyCost).rupees();
+                    }
                     cout << "\nCustomer Final Selections:\n";
                     customer.display();
                     pipeline.display();
+                    if (quote.routeFound)
+                    {
+                        quote.display();
+                    }
                 }
 
                 else
@@ -774,9 +8129,8 @@ int main()
                 {
                     // Update Maintenance Schedule
 
-                cout << "Enter new maintenance schedule: ";
-                string newSchedule;
-                cin >> newSchedule;
+                MaintenanceSchedule newSchedule;
+                promptFor("Enter new maintenance schedule (Weekly, Monthly, Quarterly, Yearly): ", newSchedule);
                 pipeline.updateMaintenanceSchedule(newSchedule);
 
                 break;
@@ -796,9 +8150,8 @@ int main()
                 int diameter;
                 cin >> diameter;
 
-                cout << "Material (Steel, PVC, Concrete): ";
-                string material;
-                cin >> material;
+                PipeMaterial material;
+                promptFor("Material (Steel, PVC, Concrete): ", material);
 
                 cout << "Flow Rate (L/s): ";
                 double flowRate;
@@ -808,9 +8161,8 @@ int main()
                 double pressure;
                 cin >> pressure;
 
-                cout << "Maintenance Schedule: ";
-                string maintSchedule;
-                cin >> maintSchedule;
+                MaintenanceSchedule maintSchedule;
+                promptFor("Maintenance Schedule (Weekly, Monthly, Quarterly, Yearly): ", maintSchedule);
 
                 Pipeline newPipe(length, diameter, material, flowRate, pressure, "Active", maintSchedule, 0.0, "Ultrasonic");
                 customer.addPipeline(newPipe);
@@ -824,9 +8176,11 @@ int main()
             string id;
             cin >> id;
 
-            if (customerDatabase.find(id) != customerDatabase.end())
+            unique_lock<mutex> readLock = durableCustomers.lockForReading();
+            const Customer* found = customerDatabase.find(id);
+            if (found)
             {
-                customerDatabase[id].display();
+                found->display();
             }
 
             else
@@ -841,14 +8195,29 @@ int main()
             cout << "Enter Customer ID: ";
             string id;
             cin >> id;
-            if (customerDatabase.find(id) != customerDatabase.end())
+            unique_lock<mutex> readLock = durableCustomers.lockForReading();
+            const Customer* found = customerDatabase.find(id);
+            bool alreadyDisconnected = found && found->disconnected;
+            readLock.unlock();
+            if (alreadyDisconnected)
+            {
+                cout << "Pipeline for customer ID " << id << " is already disconnected." << endl;
+            }
+
+            else if (found)
             {
                 cout << "Reason for Pipeline Disconnection: ";
                 string reason;
                 cin.ignore();
                 getline(cin, reason);
-                cout << "Pipeline for customer ID " << id << " has been disconnected. Reason: " << reason << endl;
-                customerDatabase.erase(id);
+                if (durableCustomers.disconnect(id, reason, (int64_t)time(NULL)))
+                {
+                    cout << "Pipeline for customer ID " << id << " has been disconnected. Reason: " << reason << endl;
+                }
+                else
+                {
+                    cout << "Pipeline for customer ID " << id << " could not be disconnected." << endl;
+                }
             }
 
             else
@@ -865,6 +8234,363 @@ int main()
 
             break;
 
+        case 14:
+        {
+            cout << "\nChoose Benchmark (1. All-pairs Distance Matrix, 2. Sharded Routing, 3. Routing During Network Edits, 4. Graph Specializations, 5. Customer Lookups, 6. Customer Analytics, 7. Usage Time-Series, 8. Durable Customer Store, 9. Concurrent Customer Store, 10. Customer Query, 11. Billing Run, 12. Money Arithmetic, 13. Tariff Lookups, 14. Slab Tariff, 15. Billing Accumulators, 16. Receivables Aging, 17. Combined Utility Billing, 18. Installation Quotes, 19. Pipe Bill of Materials): ";
+            int benchmarkChoice;
+            cin >> benchmarkChoice;
+
+            if (benchmarkChoice == 1)
+            {
+                benchmarkDistanceMatrix();
+            }
+#ifndef _WIN32
+            else if (benchmarkChoice == 2)
+            {
+                benchmarkShardedRouting();
+            }
+#endif
+            else if (benchmarkChoice == 3)
+            {
+                benchmarkVersionedGraph(g);
+            }
+            else if (benchmarkChoice == 4)
+            {
+                benchmarkGraphSpecializations();
+            }
+            else if (benchmarkChoice == 5)
+            {
+                benchmarkCustomerStore();
+            }
+            else if (benchmarkChoice == 6)
+            {
+                benchmarkCustomerColumns();
+            }
+            else if (benchmarkChoice == 7)
+            {
+                benchmarkUsageSeries();
+            }
+            else if (benchmarkChoice == 8)
+            {
+                benchmarkDurableStore();
+            }
+            else if (benchmarkChoice == 9)
+            {
+                benchmarkConcurrentStore();
+            }
+            else if (benchmarkChoice == 10)
+            {
+                benchmarkCustomerQuery();
+            }
+            else if (benchmarkChoice == 11)
+            {
+                benchmarkBillingRun();
+            }
+            else if (benchmarkChoice == 12)
+            {
+                benchmarkMoney();
+            }
+            else if (benchmarkChoice == 13)
+            {
+                benchmarkTariffLookups();
+            }
+            else if (benchmarkChoice == 14)
+            {
+                benchmarkSlabTariff();
+            }
+            else if (benchmarkChoice == 15)
+            {
+                benchmarkBillingAccumulators();
+            }
+            else if (benchmarkChoice == 16)
+            {
+                benchmarkReceivablesAging();
+            }
+            else if (benchmarkChoice == 17)
+            {
+                benchmarkUtilityBilling();
+            }
+            else if (benchmarkChoice == 18)
+            {
+                benchmarkInstallationQuotes();
+            }
+            else if (benchmarkChoice == 19)
+            {
+                benchmarkPipeBillOfMaterials();
+            }
+
+            else
+            {
+                cout << "Invalid choice." << endl;
+            }
+            break;
+        }
+
+        case 15:
+        {
+            // Leave a field blank to match any value
+            string reportLocation, reportSupply, reportCycle;
+            cin.ignore();
+            cout << "Location (blank for any): ";
+            getline(cin, reportLocation);
+            cout << "Supply Type (blank for any): ";
+            getline(cin, reportSupply);
+            cout << "Billing Cycle (blank for any): ";
+            getline(cin, reportCycle);
+
+            unique_lock<mutex> readLock = durableCustomers.lockForReading();
+            vector<const Customer*> matches = customerDatabase.query(reportLocation, reportSupply, reportCycle);
+            cout << "\n" << matches.size() << " customer(s) found:" << endl;
+            BlockWriter report(stdout);
+            for (const Customer* match : matches)
+            {
+                report.text() << match->customer_id << " - " << match->name << " (" << match->location << ", "
+                              << match->supply_type << ", " << match->billing_cycle << ")\n";
+            }
+            break;
+        }
+
+        case 16:
+        {
+            cout << "CSV columns: name,address,customer_id,location,supply_type,billing_cycle,total_usage,total_amount\n";
+            cout << "Enter CSV file path: ";
+            string csvPath;
+            cin.ignore();
+            getline(cin, csvPath);
+
+            CustomerCsvImporter importer(costEngine);
+            ImportReport report = importer.import(csvPath, durableCustomers);
+            cout << "\nRows: " << report.rows << ", imported: " << report.imported << ", rejected: " << report.rejected
+                 << " (" << report.duplicates << " duplicate IDs), no route to a pump station: " << report.unreachable
+                 << " (" << report.milliseconds << " ms)" << endl;
+            for (const string& error : report.errors)
+            {
+                cout << error << endl;
+            }
+            break;
+        }
+
+        case 17:
+        {
+            cout << "Fields: total_usage, total_amount, location, supply_type, billing_cycle; e.g.\n";
+            cout << "  total_amount > 20000 AND billing_cycle = Quarterly\n";
+            cout << "Enter filter: ";
+            string filter;
+            cin.ignore();
+            getline(cin, filter);
+
+            unique_lock<mutex> readLock = durableCustomers.lockForReading();
+            CustomerQuery query(customerDatabase);
+            if (!query.compile(filter))
+            {
+                cout << "Invalid filter: " << query.error() << endl;
+                break;
+            }
+            cout << query.count() << " customer(s) match." << endl;
+
+            // Ten at a time
+            vector<const Customer*> page;
+            while (query.nextPage(10, page))
+            {
+                for (const Customer* match : page)
+                {
+                    cout << match->customer_id << " - " << match->name << " (" << match->location << ", " << match->supply_type
+                         << ", " << match->billing_cycle << ", usage " << match->total_usage << ", amount " << match->total_amount << ")" << endl;
+                }
+                cout << "More? (y/n): ";
+                string more;
+                getline(cin, more);
+                if (more != "y" && more != "Y")
+                {
+                    break;
+                }
+            }
+            break;
+        }
+
+        case 18:
+        {
+            cout << "Enter invoice file path: ";
+            string invoicePath;
+            cin.ignore();
+            getline(cin, invoicePath);
+            FILE* invoices = fopen(invoicePath.c_str(), "wb");
+            if (!invoices)
+            {
+                cout << "Error: could not create " << invoicePath << endl;
+                break;
+            }
+
+            time_t now = time(NULL);
+            char period[16];
+            strftime(period, sizeof(period), "%b-%Y", localtime(&now));
+
+            unique_lock<mutex> readLock = durableCustomers.lockForReading();
+            BillingRun billingRun(customerDatabase, supplyPricing.table(), haveWaterSlabs ? &waterSlabs : NULL);
+            BillingReport report = billingRun.run(invoices, period);
+            readLock.unlock();
+            fclose(invoices);
+
+            if (haveWaterSlabs)
+            {
+                cout << "\nUsage billed by the slab tariff in " << SLAB_TARIFF_CONFIG << "." << endl;
+            }
+            cout << "\nBilling run for " << period << ": " << report.invoiced << " invoice(s) written to " << invoicePath
+                 << ", " << report.disconnected << " disconnected customer(s) skipped." << endl;
+            if (report.withoutTariff > 0)
+            {
+                cout << report.withoutTariff << " customer(s) have no supply tariff for their billing cycle; billed usage only." << endl;
+            }
+            cout << "Usage charges: " << report.usageCharges << ", supply charges: " << report.supplyCharges
+                 << ", total billed: " << report.usageCharges + report.supplyCharges << endl;
+            cout << report.milliseconds << " ms (" << report.customersPerSecond() << " customers/s)" << endl;
+            break;
+        }
+
+        case 19:
+        {
+            cout << "Tariff file lines: supply type,billing cycle,rate (e.g. Regular,Monthly,100.00)\n";
+            cout << "Enter tariff file path: ";
+            string tariffPath;
+            cin.ignore();
+            getline(cin, tariffPath);
+            supplyPricing.reload(tariffPath);
+            break;
+        }
+
+        case 20:
+        {
+            cout << "Enter Customer ID: ";
+            string id;
+            cin >> id;
+
+            ServiceAccount account;
+            {
+                unique_lock<mutex> readLock = durableCustomers.lockForReading();
+                const Customer* found = customerDatabase.find(id);
+                if (!found)
+                {
+                    cout << "Customer not found." << endl;
+                    break;
+                }
+                account.customer_id = found->customer_id;
+                account.name = found->name;
+                account.billing_cycle = found->billing_cycle;
+                account.supply_type = found->supply_type;
+                account.water_usage = found->total_usage;
+                account.water_amount = Money(found->total_amount);
+                if (!found->disconnected)
+                {
+                    account.add(ServiceAccount::Water);
+                }
+            }
+
+            // The other services of the customer this cycle; 0 for one they do not take
+            SlabTariff electricitySlabs, gasSlabs;
+            ElectricityTariff electricity{&electricityConnectionTariff, {NULL, Money()}};
+            GasTariff gas{{NULL, Money()}, Percentage()};
+            WiFiTariff wifi{Money(), Money()};
+            cout << "Enter electricity units used (0 if none): ";
+            cin >> account.electricity_units;
+            if (account.electricity_units > 0)
+            {
+                account.add(ServiceAccount::Electricity);
+                string connectionType;
+                cout << "Enter connection type (Residential/Commercial): ";
+                cin >> connectionType;
+                account.connection_type = connectionType;
+                if (SlabTariff::load(SLAB_TARIFF_CONFIG, "electricity", electricitySlabs))
+                {
+                    electricity.usage.slabs = &electricitySlabs;
+                }
+                else
+                {
+                    promptFor("Enter the electricity rate per unit (in rupees): ", electricity.usage.ratePerUnit);
+                }
+            }
+            cout << "Enter gas units used (0 if none): ";
+            cin >> account.gas_units;
+            if (account.gas_units > 0)
+            {
+                account.add(ServiceAccount::Gas);
+                if (SlabTariff::load(SLAB_TARIFF_CONFIG, "gas", gasSlabs))
+                {
+                    gas.usage.slabs = &gasSlabs;
+                }
+                else
+                {
+                    promptFor("Enter the gas rate per unit (in rupees): ", gas.usage.ratePerUnit);
+                }
+                promptFor("Enter the gas tax rate (in percentage): ", gas.taxRate);
+            }
+            cout << "Enter the Wi-Fi service fee (0 if none): ";
+            cin >> wifi.serviceFee;
+            if (wifi.serviceFee > Money())
+            {
+                account.add(ServiceAccount::WiFi);
+                string newConnection;
+                cout << "Is this the first Wi-Fi bill? (yes/no): ";
+                cin >> newConnection;
+                account.wifi_activation = newConnection == "yes";
+                if (account.wifi_activation)
+                {
+                    cout << "Enter the Wi-Fi activation fee (in rupees): ";
+                    cin >> wifi.activationFee;
+                }
+            }
+            if (!cin)
+            {
+                cout << "Invalid amount." << endl;
+                cin.clear();
+                cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                break;
+            }
+
+            time_t now = time(NULL);
+            char period[16];
+            strftime(period, sizeof(period), "%b-%Y", localtime(&now));
+            UtilityBilling<WaterTariff, ElectricityTariff, GasTariff, WiFiTariff> billing(
+                WaterTariff{&supplyPricing.table(), haveWaterSlabs ? &waterSlabs : NULL}, electricity, gas, wifi);
+            UtilityBillingReport report;
+            BlockWriter out(stdout);
+            out.text() << '\n';
+            billing.bill(account, period, out.text(), report);
+            if (report.invoiced == 0)
+            {
+                out.text() << "Nothing to bill: the customer takes none of the services.\n";
+            }
+            break;
+        }
+
+        case 21:
+        {
+#ifndef _WIN32
+            if (!shardedRouter->isReady())
+            {
+                cout << "Error: the sharded router is not available; restart the program to start it again." << endl;
+                break;
+            }
+            string from, to;
+            cout << "Enter the first area: ";
+            cin.ignore();
+            getline(cin, from);
+            cout << "Enter the second area: ";
+            getline(cin, to);
+            int distance = shardedRouter->shortestDistance(from, to);
+            if (distance < 0)
+            {
+                cout << "No route between " << from << " and " << to << "." << endl;
+            }
+            else
+            {
+                cout << "Shortest distance from " << from << " to " << to << ": " << distance << " meters" << endl;
+            }
+#else
+            cout << "The sharded router needs POSIX processes and sockets." << endl;
+#endif
+            break;
+        }
+
         default:
             cout << "Invalid choice. Please try again." << endl;
 
@@ -1821,6 +9547,13 @@ int main()
     // Display the sub-division office and area details for the selected area
     displaySubDivisionDetails(selected_area, area_details);
 
+    // Display the all-pairs distances between the areas of the sub-division office
+    if (area_details.count(selected_area))
+    {
+        DistanceMatrix office_distances = computeSubDivisionDistanceMatrix(selected_area, area_details[selected_area], g);
+        displayDistanceMatrix(office_distances);
+    }
+
     // Ask the user for their choice to find the nearest area
     cout << "\nEnter the Choice that you have selected for shortest distance: ";
     int user_choice;
@@ -1868,12 +9601,11 @@ int main()
         totalLength += segmentLengths[i];
     }
 
-    // Calculate total material volume and weight
-    double totalVolume = 0.0;
-    for (double length : segmentLengths) {
-        totalVolume += calculatePipeVolume(length, outerDiameter, thickness);
-    }
-    double totalWeight = totalVolume * density;
+    // Calculate total material volume and weight in one pass over the segments
+    vector<double> outerDiameters(segmentLengths.size(), outerDiameter), thicknesses(segmentLengths.size(), thickness);
+    PipeBillOfMaterials pipeMaterials = pipeBillOfMaterials(segmentLengths.data(), outerDiameters.data(), thicknesses.data(), segmentLengths.size());
+    double totalVolume = pipeMaterials.pipeVolume;
+    double totalWeight = pipeMaterials.pipeWeight(density);
 
     // Output results
     cout << "\nPipeline Material Usage Summary:" << endl;
@@ -1916,6 +9648,7 @@ int main()
 
 
     // Input lengths of each segment
+    segmentLengths.resize(segmentCount);
     cout << "Enter the length of each segment (in meters):" << endl;
     for (int i = 0; i < segmentCount; i++) {
         cout << "Segment " << i + 1 << ": ";
@@ -1923,13 +9656,12 @@ int main()
         totalLength += segmentLengths[i];
     }
 
-    // Calculate total coating area and weight
-    double totalSurfaceArea = 0.0;
-    for (double length : segmentLengths) {
-        totalSurfaceArea += calculateSurfaceArea(length, outerDiameter);
-    }
-    double coatingVolume = totalSurfaceArea * coatingThickness;
-    double coatingWeight = coatingVolume * coatingDensity;
+    // Calculate total coating area and weight in one pass over the segments
+    outerDiameters.assign(segmentLengths.size(), outerDiameter);
+    PipeBillOfMaterials coatedPipe = pipeBillOfMaterials(segmentLengths.data(), outerDiameters.data(), NULL, segmentLengths.size());
+    double totalSurfaceArea = coatedPipe.surfaceArea;
+    double coatingVolume = coatedPipe.coatingVolume(coatingThickness);
+    double coatingWeight = coatedPipe.coatingWeight(coatingThickness, coatingDensity);
 
     // Output results
     cout << "\nCoating Material Usage Summary:" << endl;
@@ -2000,19 +9732,26 @@ int main()
     }
 
      // Variables to hold user inputs
-    float unitsUsed, ratePerUnit;
+    float unitsUsed;
+    Money ratePerUnit;
+
+    // Slab rates from tariffs.cfg [gas] replace the flat rate per unit
+    SlabTariff gasSlabs;
+    bool haveGasSlabs = SlabTariff::load(SLAB_TARIFF_CONFIG, "gas", gasSlabs);
 
     // Gather input from the user
     cout << "Enter the number of gas units used: ";
     cin >> unitsUsed;
 
-    cout << "Enter the rate per unit (in rupees): ";
-    cin >> ratePerUnit;
+    if (!haveGasSlabs)
+    {
+        promptFor("Enter the rate per unit (in rupees): ", ratePerUnit);
+    }
 
     // Calculate bills
-    float monthlyBill = unitsUsed * ratePerUnit;
-    float quarterlyBill = monthlyBill * 3; // Quarterly means 3 months
-    float yearlyBill = monthlyBill * 12;  // Yearly means 12 months
+    Money monthlyBill = haveGasSlabs ? gasSlabs.charge(unitsUsed) : ratePerUnit.times(unitsUsed);
+    Money quarterlyBill = monthlyBill * 3; // Quarterly means 3 months
+    Money yearlyBill = monthlyBill * 12;  // Yearly means 12 months
 
     // Display the results
     cout << "Monthly bill: " << monthlyBill << " rupees" << endl;
@@ -2022,24 +9761,29 @@ int main()
 
 
 // Variables to hold user inputs
-    float gasBill, taxRate, totalBill;
+    Money gasBill, totalBill;
+    Percentage taxRate;
     string dueDate, paymentStatus;
 
     // Gather input from the user
-    cout << "Enter the gas bill amount (in rupees): ";
-    cin >> gasBill;
+    promptFor("Enter the gas bill amount (in rupees): ", gasBill);
 
-    cout << "Enter the tax rate (in percentage): ";
-    cin >> taxRate;
+    promptFor("Enter the tax rate (in percentage): ", taxRate);
 
+    string billCustomerID;
+    cout << "Enter the customer ID: ";
+    cin >> billCustomerID;
+
+    int32_t dueDay;
     cout << "Enter the due date (e.g., 10-Jan-2025): ";
-    cin >> dueDate;
+    while (cin >> dueDate && (!parseDay(dueDate, dueDay) || abs(dueDay - currentDay()) > Receivables::MAX_SPAN_DAYS))
+        cout << "Invalid date (it must be within ten years of today). Enter the due date (e.g., 10-Jan-2025): ";
 
     cout << "Has the bill been paid? (yes/no): ";
     cin >> paymentStatus;
 
     // Calculate total bill with tax
-    float taxAmount = (gasBill * taxRate) / 100;
+    Money taxAmount = taxRate.of(gasBill);
     totalBill = gasBill + taxAmount;
 
     // Display the total bill
@@ -2047,12 +9791,60 @@ int main()
     cout << "Tax (" << taxRate << "%): " << taxAmount << " rupees" << endl;
     cout << "Total bill amount: " << totalBill << " rupees" << endl;
 
-    // Check payment status
+    // Check payment status. Open gas bills are kept in GAS_RECEIVABLES_FILE by customer ID and due date:
+    // a paid bill is settled there, an unpaid one is added once and aged with the others.
     if (paymentStatus == "yes") {
         cout << "Thank you! The bill has been paid on time." << endl;
+        Receivables receivables;
+        size_t skipped = 0;
+        receivables.load(GAS_RECEIVABLES_FILE, skipped);
+        uint32_t bill = receivables.billOf(billCustomerID, dueDay);
+        if (bill != Receivables::NO_BILL) {
+            receivables.settle(bill);
+            if (receivables.save(GAS_RECEIVABLES_FILE)) {
+                cout << "The open bill of " << billCustomerID << " due " << dueDate << " is now settled." << endl;
+            } else {
+                cout << "Error: unable to write " << GAS_RECEIVABLES_FILE << "." << endl;
+            }
+        }
     } else {
         cout << "The bill has not been paid. Due date was: " << dueDate << endl;
         cout << "Please pay the bill immediately to avoid penalties." << endl;
+
+        // Age every open gas bill as the nightly receivables job would today
+        Percentage penaltyRate;
+        promptFor("Enter the late-payment penalty per month (in percentage): ", penaltyRate);
+        Receivables receivables(penaltyRate);
+        size_t skipped = 0;
+        receivables.load(GAS_RECEIVABLES_FILE, skipped);
+        if (skipped > 0) {
+            cout << "Warning: " << skipped << " line(s) of " << GAS_RECEIVABLES_FILE << " could not be read." << endl;
+        }
+        uint32_t bill = receivables.billOf(billCustomerID, dueDay);
+        if (bill != Receivables::NO_BILL) {
+            cout << "This bill is already open (" << receivables.amountOf(bill) << " rupees); it is not added again." << endl;
+        } else {
+            bill = receivables.add(billCustomerID, dueDay, totalBill);
+        }
+        if (bill == Receivables::NO_BILL) {
+            cout << "Error: the due date is too far from those of the open bills; the bill was not recorded." << endl;
+        } else {
+            int32_t today = currentDay();
+            AgingReport aging = receivables.age(today, 1);
+            if (today <= dueDay) {
+                cout << "The bill is not overdue yet (" << dueDay - today << " day(s) left)." << endl;
+            } else {
+                cout << "Days overdue: " << today - dueDay << " ("
+                     << AgingReport::LABELS[AgingReport::bucketOf(today - dueDay)] << ")" << endl;
+                cout << "Late-payment penalty: " << receivables.penaltyOf(bill) << " rupees" << endl;
+                cout << "Amount now due: " << receivables.amountOf(bill) + receivables.penaltyOf(bill) << " rupees" << endl;
+            }
+            cout << "Open gas bills: " << receivables.size() << endl;
+            aging.display();
+            if (!receivables.save(GAS_RECEIVABLES_FILE)) {
+                cout << "Error: unable to write " << GAS_RECEIVABLES_FILE << "." << endl;
+            }
+        }
     }
     int eastHomes, westHomes, northHomes, southHomes;
     int eastUsage, westUsage, northUsage, southUsage;
@@ -2373,11 +10165,17 @@ public:
 
     void display()
     {
-        cout << "\nElectricity Line Details: Length = " << length << " meters, Capacity = " << capacity
-             << " kW, Material = " << material << ", Voltage = " << voltage
-             << " V, Current = " << current << " A, Status = " << status
-             << ", Maintenance Schedule = " << maintenance_schedule << ", Cost = " << cost
-             << ", Fault Detection Type = " << fault_detection_type << endl;
+        BlockWriter out(stdout);
+        render(out.text());
+    }
+
+    void render(TextBuffer &out) const
+    {
+        out << "\nElectricity Line Details: Length = " << length << " meters, Capacity = " << capacity
+            << " kW, Material = " << material << ", Voltage = " << voltage
+            << " V, Current = " << current << " A, Status = " << status
+            << ", Maintenance Schedule = " << maintenance_schedule << ", Cost = " << cost
+            << ", Fault Detection Type = " << fault_detection_type << '\n';
     }
 
     void updateMaintenanceSchedule(string newSchedule)
@@ -2401,7 +10199,9 @@ public:
     double total_usage; // Total electricity usage during billing cycle
     double total_amount; // Total amount to be paid
     vector<ElectricityLine> electricity_lines; // A customer may have multiple electricity lines
-    vector<string> usage_history; // History of electricity usage and billing information
+    UsageSeries usage_history; // Meter readings (time, electricity usage, amount), kept in sharedUsageArena()
+    BillingAccumulator billing_totals; // Running totals of usage_history for the open billing cycle
+    vector<BillingCycleTotals> closed_cycles;
 
     Customer(string n, string addr, string id, string loc, string conn, string cycle, double usage, double amount)
         : name(n),
@@ -2415,21 +10215,30 @@ public:
 
     void display()
     {
-        cout << "\nCustomer Details: \nName: " << name << "\nAddress: " << address
-             << "\nCustomer ID: " << customer_id << "\nLocation: " << location
-             << "\nConnection Type: " << connection_type << "\nBilling Cycle: " << billing_cycle
-             << "\nTotal Electricity Usage: " << total_usage << "\nTotal Amount: " << total_amount << endl;
+        BlockWriter writer(stdout);
+        writer.text() << "\nCustomer Details: \nName: " << name << "\nAddress: " << address
+                      << "\nCustomer ID: " << customer_id << "\nLocation: " << location
+                      << "\nConnection Type: " << connection_type << "\nBilling Cycle: " << billing_cycle
+                      << "\nTotal Electricity Usage: " << total_usage << "\nTotal Amount: " << total_amount << '\n';
 
-        cout << "\nElectricity Line Details: " << endl;
+        writer.text() << "\nElectricity Line Details: \n";
         for (auto &line : electricity_lines)
         {
-            line.display();
+            line.render(writer.text());
         }
 
-        cout << "\nUsage History: " << endl;
-        for (const string &record : usage_history)
+        writer.text() << "\nUsage History: \n";
+        usage_history.forEach(sharedUsageArena(), INT64_MIN, INT64_MAX, [&writer](const UsageReading &r)
+        {
+            writer.text().timestamp(r.timestamp) << ": usage " << r.volume << ", amount " << r.amount << '\n';
+        });
+
+        writer.text() << "\nCurrent Billing Cycle: ";
+        billing_totals.current(time(NULL)).render(writer.text());
+        for (const BillingCycleTotals &cycle : closed_cycles)
         {
-            cout << record << endl;
+            writer.text() << "Closed Billing Cycle: ";
+            cycle.render(writer.text());
         }
     }
 
@@ -2439,10 +10248,24 @@ public:
         cout << "New electricity line added for " << name << endl;
     }
 
-    void addUsageRecord(string record)
+    void addUsageRecord(int64_t timestamp, double usage, double amount)
+    {
+        if (usage_history.append(sharedUsageArena(), UsageReading{timestamp, usage, amount}))
+        {
+            billing_totals.add(UsageReading{timestamp, usage, amount});
+            cout << "Usage record added: " << formatTimestamp(timestamp) << ", usage " << usage << ", amount " << amount << endl;
+        }
+        else
+        {
+            cout << "Usage reading is older than the last one recorded." << endl;
+        }
+    }
+
+    // Close the open billing cycle at closedAt from the running totals and keep it with the closed ones
+    const BillingCycleTotals& closeBillingCycle(int64_t closedAt)
     {
-        usage_history.push_back(record);
-        cout << "Usage record added: " << record << endl;
+        closed_cycles.push_back(billing_totals.close(closedAt));
+        return closed_cycles.back();
     }
 };
 
@@ -2491,59 +10314,11 @@ public:
 
 // Graph to store the network of pump stations and areas
 
-class Graph
+class Graph : public BasicGraph<int, string> // stores the adjacency list, with distances as weights
 {
 public:
-    map<string, vector<pair<string, int>>> adj; // stores the adjacency list, with distances as weights
-
-    void addEdge(string u, string v, int distance)
-    {
-        adj[u].push_back(make_pair(v, distance));
-        adj[v].push_back(make_pair(u, distance)); // Assuming it's undirected
-    }
-
-    map<string, int> dijkstra(string source)
-    {
-        map<string, int> dist;
-        for (auto &node : adj)
-        {
-            dist[node.first] = INT_MAX;
-        }
-        dist[source] = 0;
-
-        priority_queue<pair<int, string>, vector<pair<int, string>>, greater<pair<int, string>>> pq;
-        pq.push(make_pair(0, source));
-
-        while (!pq.empty())
-        {
-            int u_dist = pq.top().first;
-            string u = pq.top().second;
-            pq.pop();
-
-            if (u_dist > dist[u])
-                continue;
-
-            for (auto &neighbor : adj[u])
-            {
-                string v = neighbor.first;
-                int weight = neighbor.second;
-
-                if (dist[u] + weight < dist[v])
-                {
-                    dist[v] = dist[u] + weight;
-                    pq.push(make_pair(dist[v], v));
-                }
-            }
-        }
-        return dist;
-    }
-
     int getShortestDistanceToSubstation(string customerLocation)
     {
-        map<string, int> distances = dijkstra(customerLocation);
-
-        int minDistance = INT_MAX;
-
         // 6. Optionally handle edge cases
 //    - Example: If the user inputs an invalid choice or wrong data types, display an error message
 //    - Example:
@@ -2558,14 +10333,7 @@ public:
 //    - Example: cout << "Exiting program..."; return 0;
 
 // ** End of Pseudocode Section **
-        for (auto &d : distances)
-        {
-            if (d.first != customerLocation && d.second < minDistance)
-            {
-                minDistance = d.second;
-            }
-        }
-        return (minDistance == INT_MAX) ? -1 : minDistance;
+        return nearestOtherNodeDistance(customerLocation);
     }
 };
 
@@ -2587,15 +10355,17 @@ void displayMenu()
     cout << "9. Update Maintenance Schedule\n";
     cout << "10. Add New Electricity Line\n";
     cout << "11. Exit\n";
+    cout << "12. Record Meter Reading\n";
+    cout << "13. Close Billing Cycle\n";
 }
 int main() {
     string name, address, customerID, location, connectionType, material, billingCycle, faultDetectionType;
     double totalUsage = 0.0, totalAmount = 0.0;
 
     // Material rates (cost per meter)
-    map<string, double> materialRates = {
-        {"Copper", 150.0},   // Copper costs 150 currency per meter
-        {"Aluminum", 100.0} // Aluminum costs 100 currency per meter
+    map<string, Money> materialRates = {
+        {"Copper", Money(150.0)},   // Copper costs 150 currency per meter
+        {"Aluminum", Money(100.0)} // Aluminum costs 100 currency per meter
     };
 
     // Fault detection options
@@ -2605,10 +10375,11 @@ int main() {
     };
 
     // Connection types and pricing
-    map<string, map<string, double>> connectionPricing = {
-        {"Residential", {{"Monthly", 1000}, {"Quarterly", 2500}, {"Weekly", 400}}},
-        {"Commercial", {{"Monthly", 3000}, {"Quarterly", 7500}, {"Weekly", 1200}}}
-    };
+    // Metered usage is charged by the slab tariff in tariffs.cfg [electricity]
+    SlabTariff electricitySlabs;
+    bool haveElectricitySlabs = SlabTariff::load(SLAB_TARIFF_CONFIG, "electricity", electricitySlabs);
+
+    const ConnectionPriceGrid& connectionPricing = electricityConnectionTariff;
 
     // Customer information
     cout << "Enter Customer Name: ";
@@ -2750,11 +10521,24 @@ int main() {
 
     ElectricityLine electricityLine(shortestDistance, 50, "Copper", 220.0, 10.0, "Active", "Monthly", 0.0, "");
 
+    // Prices the line along the actual route to the nearest substation
+    RouteCostEngine<Graph, map<string, Money>, ConnectionPriceGrid> costEngine(g, materialRates, connectionPricing);
+
+    // Substations and the ground along each segment, from network.cfg
+    NetworkConditions electricityNetwork;
+    if (NetworkConditions::load(NETWORK_CONFIG, "electricity", electricityNetwork)) {
+        size_t unknown = costEngine.configure(electricityNetwork);
+        if (unknown > 0)
+            cout << "Warning: " << unknown << " station(s) / segment(s) in " << NETWORK_CONFIG << " [electricity] are not in the network." << endl;
+    } else {
+        cout << "Note: no [electricity] section in " << NETWORK_CONFIG << "; quotes route to the closest node on flat ground." << endl;
+    }
+
     int choice;
     bool exitMenu = false, materialSelected = false, billingSelected = false, faultDetectionSelected = false, connectionTypeSelected = false;
 
     while (!exitMenu) {
-        cout << "\nMenu:\n1. Choose Material Type\n2. Choose Billing Cycle\n3. Choose Fault Detection Type\n4. Choose Connection Type\n5. View Electricity Line Details\n6. View Customer Details\n7. Finalize Selections\n8. Exit\n";
+        cout << "\nMenu:\n1. Choose Material Type\n2. Choose Billing Cycle\n3. Choose Fault Detection Type\n4. Choose Connection Type\n5. View Electricity Line Details\n6. View Customer Details\n7. Finalize Selections\n8. Exit\n9. Record Meter Reading\n10. Close Billing Cycle\n";
         cout << "Enter your choice: ";
         cin >> choice;
 
@@ -2845,13 +10629,20 @@ int main() {
 
             case 7: {
                 if (materialSelected && billingSelected && faultDetectionSelected && connectionTypeSelected) {
-                    double materialCost = materialRates[material];
-                    double connectionCost = connectionPricing[connectionType][billingCycle];
-                    double totalCost = materialCost * electricityLine.length + connectionCost;
-                    customer.total_amount = totalCost;
+                    const InstallationQuote& quote = costEngine.quote(location, material, connectionType, billingCycle);
+                    if (quote.routeFound) {
+                        customer.total_amount = quote.total.rupees();
+                    } else {
+                        Money materialCost = materialRates[material];
+                        Money connectionCost = connectionPricing.at(ConnectionType(connectionType), BillingCycle(billingCycle));
+                        customer.total_amount = (materialCost.times(electricityLine.length) + connectionCost).rupees();
+                    }
 
                     cout << "\nFinal Customer Details:\n";
                     customer.display();
+                    if (quote.routeFound) {
+                        quote.display();
+                    }
                 } else {
                     cout << "Please complete all selections before finalizing.\n";
                 }
@@ -2864,6 +10655,33 @@ int main() {
                 break;
             }
 
+            case 9: {
+                if (!haveElectricitySlabs) {
+                    cout << "No [electricity] slab tariff in " << SLAB_TARIFF_CONFIG << ".\n";
+                    break;
+                }
+                double units;
+                cout << "Enter units consumed since the last reading: ";
+                cin >> units;
+                if (units < 0) {
+                    cout << "Invalid reading.\n";
+                    break;
+                }
+                int64_t now = time(NULL);
+                Money charge = electricitySlabs.charge(units, electricitySlabs.periodAt(now));
+                customer.total_usage += units;
+                customer.total_amount += charge.rupees();
+                customer.addUsageRecord(now, units, charge.rupees());
+                break;
+            }
+
+            case 10: {
+                const BillingCycleTotals& closed = customer.closeBillingCycle(time(NULL));
+                cout << "Billing cycle closed: ";
+                closed.display();
+                break;
+            }
+
             default: {
                 cout << "Invalid choice. Please try again.\n";
                 break;
@@ -2915,33 +10733,36 @@ double calculateInstallationTypeCost(const string& installationType) {
 
 // Function to display customer details
 void displayCustomerDetails(const Customer& customer) {
-    cout << "\nCustomer Details:\n";
-    cout << "Name: " << customer.name << endl;
-    cout << "Customer ID: " << customer.customerID << endl;
-    cout << "Address: " << customer.address << endl;
-    cout << "Contact Information: " << customer.contactInfo << endl;
+    BlockWriter out(stdout);
+    out.text() << "\nCustomer Details:\n"
+               << "Name: " << customer.name << '\n'
+               << "Customer ID: " << customer.customerID << '\n'
+               << "Address: " << customer.address << '\n'
+               << "Contact Information: " << customer.contactInfo << '\n';
 }
 
 // Function to display pipeline details
 void displayPipelineDetails(const Pipeline& pipeline) {
-    cout << "\nPipeline Details:\n";
-    cout << "Material: " << pipeline.material << endl;
-    cout << "Length: " << pipeline.length << " meters" << endl;
-    cout << "Diameter: " << pipeline.diameter << " mm" << endl;
-    cout << "Routing: " << pipeline.routing << endl;
-    cout << "Location: " << pipeline.location << endl;
-    cout << "Capacity: " << pipeline.capacity << " Gbps" << endl;
-    cout << "Installation Type: " << pipeline.installationType << endl;
-    cout << "Installation Cost: " << pipeline.installationCost << " units" << endl; // Display installation cost
+    BlockWriter out(stdout);
+    out.text() << "\nPipeline Details:\n"
+               << "Material: " << pipeline.material << '\n'
+               << "Length: " << pipeline.length << " meters" << '\n'
+               << "Diameter: " << pipeline.diameter << " mm" << '\n'
+               << "Routing: " << pipeline.routing << '\n'
+               << "Location: " << pipeline.location << '\n'
+               << "Capacity: " << pipeline.capacity << " Gbps" << '\n'
+               << "Installation Type: " << pipeline.installationType << '\n'
+               << "Installation Cost: " << pipeline.installationCost << " units" << '\n'; // Display installation cost
 }
 
 // Function to display billing details
 void displayBillingDetails(const Billing& billing) {
-    cout << "\nBilling Details:\n";
-    cout << "Billing Type: " << billing.billingType << endl;
-    cout << "Subscription Plan: " << billing.subscriptionPlan << endl;
-    cout << "Service Fee: " << billing.serviceFee << " units" << endl;
-    cout << "Activation Fee: " << billing.activationFee << " units" << endl;
+    BlockWriter out(stdout);
+    out.text() << "\nBilling Details:\n"
+               << "Billing Type: " << billing.billingType << '\n'
+               << "Subscription Plan: " << billing.subscriptionPlan << '\n'
+               << "Service Fee: " << billing.serviceFee << " units" << '\n'
+               << "Activation Fee: " << billing.activationFee << " units" << '\n';
 }
 
 // Main function to input and manage Wi-Fi pipeline details
@@ -4137,12 +11958,11 @@ int main()
         totalLength += segmentLengths[i];
     }
 
-    // Calculate total material volume and weight
-    double totalVolume = 0.0;
-    for (double length : segmentLengths) {
-        totalVolume += calculatePipeVolume(length, outerDiameter, thickness);
-    }
-    double totalWeight = totalVolume * density;
+    // Calculate total material volume and weight in one pass over the segments
+    vector<double> outerDiameters(segmentLengths.size(), outerDiameter), thicknesses(segmentLengths.size(), thickness);
+    PipeBillOfMaterials pipeMaterials = pipeBillOfMaterials(segmentLengths.data(), outerDiameters.data(), thicknesses.data(), segmentLengths.size());
+    double totalVolume = pipeMaterials.pipeVolume;
+    double totalWeight = pipeMaterials.pipeWeight(density);
 
     // Output results
     cout << "\nPipeline Material Usage Summary:" << endl;
@@ -4185,6 +12005,7 @@ int main()
 
 
     // Input lengths of each segment
+    segmentLengths.resize(segmentCount);
     cout << "Enter the length of each segment (in meters):" << endl;
     for (int i = 0; i < segmentCount; i++) {
         cout << "Segment " << i + 1 << ": ";
@@ -4192,13 +12013,12 @@ int main()
         totalLength += segmentLengths[i];
     }
 
-    // Calculate total coating area and weight
-    double totalSurfaceArea = 0.0;
-    for (double length : segmentLengths) {
-        totalSurfaceArea += calculateSurfaceArea(length, outerDiameter);
-    }
-    double coatingVolume = totalSurfaceArea * coatingThickness;
-    double coatingWeight = coatingVolume * coatingDensity;
+    // Calculate total coating area and weight in one pass over the segments
+    outerDiameters.assign(segmentLengths.size(), outerDiameter);
+    PipeBillOfMaterials coatedPipe = pipeBillOfMaterials(segmentLengths.data(), outerDiameters.data(), NULL, segmentLengths.size());
+    double totalSurfaceArea = coatedPipe.surfaceArea;
+    double coatingVolume = coatedPipe.coatingVolume(coatingThickness);
+    double coatingWeight = coatedPipe.coatingWeight(coatingThickness, coatingDensity);
 
     // Output results
     cout << "\nCoating Material Usage Summary:" << endl;
@@ -4269,19 +12089,26 @@ int main()
     }
 
      // Variables to hold user inputs
-    float unitsUsed, ratePerUnit;
+    float unitsUsed;
+    Money ratePerUnit;
+
+    // Slab rates from tariffs.cfg [gas] replace the flat rate per unit
+    SlabTariff gasSlabs;
+    bool haveGasSlabs = SlabTariff::load(SLAB_TARIFF_CONFIG, "gas", gasSlabs);
 
     // Gather input from the user
     cout << "Enter the number of gas units used: ";
     cin >> unitsUsed;
 
-    cout << "Enter the rate per unit (in rupees): ";
-    cin >> ratePerUnit;
+    if (!haveGasSlabs)
+    {
+        promptFor("Enter the rate per unit (in rupees): ", ratePerUnit);
+    }
 
     // Calculate bills
-    float monthlyBill = unitsUsed * ratePerUnit;
-    float quarterlyBill = monthlyBill * 3; // Quarterly means 3 months
-    float yearlyBill = monthlyBill * 12;  // Yearly means 12 months
+    Money monthlyBill = haveGasSlabs ? gasSlabs.charge(unitsUsed) : ratePerUnit.times(unitsUsed);
+    Money quarterlyBill = monthlyBill * 3; // Quarterly means 3 months
+    Money yearlyBill = monthlyBill * 12;  // Yearly means 12 months
 
     // Display the results
     cout << "Monthly bill: " << monthlyBill << " rupees" << endl;
@@ -4291,24 +12118,29 @@ int main()
 
 
 // Variables to hold user inputs
-    float gasBill, taxRate, totalBill;
+    Money gasBill, totalBill;
+    Percentage taxRate;
     string dueDate, paymentStatus;
 
     // Gather input from the user
-    cout << "Enter the gas bill amount (in rupees): ";
-    cin >> gasBill;
+    promptFor("Enter the gas bill amount (in rupees): ", gasBill);
+
+    promptFor("Enter the tax rate (in percentage): ", taxRate);
 
-    cout << "Enter the tax rate (in percentage): ";
-    cin >> taxRate;
+    string billCustomerID;
+    cout << "Enter the customer ID: ";
+    cin >> billCustomerID;
 
+    int32_t dueDay;
     cout << "Enter the due date (e.g., 10-Jan-2025): ";
-    cin >> dueDate;
+    while (cin >> dueDate && (!parseDay(dueDate, dueDay) || abs(dueDay - currentDay()) > Receivables::MAX_SPAN_DAYS))
+        cout << "Invalid date (it must be within ten years of today). Enter the due date (e.g., 10-Jan-2025): ";
 
     cout << "Has the bill been paid? (yes/no): ";
     cin >> paymentStatus;
 
     // Calculate total bill with tax
-    float taxAmount = (gasBill * taxRate) / 100;
+    Money taxAmount = taxRate.of(gasBill);
     totalBill = gasBill + taxAmount;
 
     // Display the total bill
@@ -4316,12 +12148,60 @@ int main()
     cout << "Tax (" << taxRate << "%): " << taxAmount << " rupees" << endl;
     cout << "Total bill amount: " << totalBill << " rupees" << endl;
 
-    // Check payment status
+    // Check payment status. Open gas bills are kept in GAS_RECEIVABLES_FILE by customer ID and due date:
+    // a paid bill is settled there, an unpaid one is added once and aged with the others.
     if (paymentStatus == "yes") {
         cout << "Thank you! The bill has been paid on time." << endl;
+        Receivables receivables;
+        size_t skipped = 0;
+        receivables.load(GAS_RECEIVABLES_FILE, skipped);
+        uint32_t bill = receivables.billOf(billCustomerID, dueDay);
+        if (bill != Receivables::NO_BILL) {
+            receivables.settle(bill);
+            if (receivables.save(GAS_RECEIVABLES_FILE)) {
+                cout << "The open bill of " << billCustomerID << " due " << dueDate << " is now settled." << endl;
+            } else {
+                cout << "Error: unable to write " << GAS_RECEIVABLES_FILE << "." << endl;
+            }
+        }
     } else {
         cout << "The bill has not been paid. Due date was: " << dueDate << endl;
         cout << "Please pay the bill immediately to avoid penalties." << endl;
+
+        // Age every open gas bill as the nightly receivables job would today
+        Percentage penaltyRate;
+        promptFor("Enter the late-payment penalty per month (in percentage): ", penaltyRate);
+        Receivables receivables(penaltyRate);
+        size_t skipped = 0;
+        receivables.load(GAS_RECEIVABLES_FILE, skipped);
+        if (skipped > 0) {
+            cout << "Warning: " << skipped << " line(s) of " << GAS_RECEIVABLES_FILE << " could not be read." << endl;
+        }
+        uint32_t bill = receivables.billOf(billCustomerID, dueDay);
+        if (bill != Receivables::NO_BILL) {
+            cout << "This bill is already open (" << receivables.amountOf(bill) << " rupees); it is not added again." << endl;
+        } else {
+            bill = receivables.add(billCustomerID, dueDay, totalBill);
+        }
+        if (bill == Receivables::NO_BILL) {
+            cout << "Error: the due date is too far from those of the open bills; the bill was not recorded." << endl;
+        } else {
+            int32_t today = currentDay();
+            AgingReport aging = receivables.age(today, 1);
+            if (today <= dueDay) {
+                cout << "The bill is not overdue yet (" << dueDay - today << " day(s) left)." << endl;
+            } else {
+                cout << "Days overdue: " << today - dueDay << " ("
+                     << AgingReport::LABELS[AgingReport::bucketOf(today - dueDay)] << ")" << endl;
+                cout << "Late-payment penalty: " << receivables.penaltyOf(bill) << " rupees" << endl;
+                cout << "Amount now due: " << receivables.amountOf(bill) + receivables.penaltyOf(bill) << " rupees" << endl;
+            }
+            cout << "Open gas bills: " << receivables.size() << endl;
+            aging.display();
+            if (!receivables.save(GAS_RECEIVABLES_FILE)) {
+                cout << "Error: unable to write " << GAS_RECEIVABLES_FILE << "." << endl;
+            }
+        }
     }
     int eastHomes, westHomes, northHomes, southHomes;
     int eastUsage, westUsage, northUsage, southUsage;